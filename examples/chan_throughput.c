@@ -0,0 +1,90 @@
+/*
+Cross-thread throughput benchmark for channels.
+
+    chan_throughput [messages] [capacity] [batch]
+
+Two producers and two consumers share one channel, the scheduler spreads
+them over it's worker threads, every message is an `chan_send/chan_recv` pair.
+An `capacity` of 0 measures unbuffered channel hand off.
+
+With an `batch` size, the channel is an `channel_of(sizeof(int))`, messages
+are stored inline, and moved `batch` at a time with `chan_send_n/chan_recv_n`.
+*/
+#define USE_CORO
+#include "channel.h"
+
+static int messages, batch;
+
+void_t producer(params_t args) {
+    channel_t c = args[0].object;
+    int i, j, *items;
+
+    if (batch > 0) {
+        items = calloc_local(batch, sizeof(int));
+        for (i = 1; i <= messages; i += j) {
+            for (j = 0; j < batch && i + j <= messages; j++)
+                items[j] = i + j;
+
+            chan_send_n(c, items, j);
+        }
+    } else {
+        for (i = 1; i <= messages; i++)
+            chan_send(c, casting(i));
+    }
+
+    return casting(coro_thrd_id() + 1);
+}
+
+void_t consumer(params_t args) {
+    channel_t c = args[0].object;
+    size_t sum = 0, n, j;
+    int i, *items;
+
+    if (batch > 0) {
+        items = calloc_local(batch, sizeof(int));
+        for (i = 0; i < messages; i += (int)n) {
+            n = chan_recv_n(c, items, messages - i < batch ? messages - i : batch);
+            for (j = 0; j < n; j++)
+                sum += items[j];
+        }
+    } else {
+        for (i = 0; i < messages; i++)
+            sum += chan_recv(c).integer;
+    }
+
+    return casting(sum);
+}
+
+int main(int argc, char **argv) {
+    int capacity = argc > 2 ? atoi(argv[2]) : 64;
+    channel_t c;
+    rid_t consumers[2];
+    uint64_t start, elapsed;
+    waitgroup_t wg;
+    waitresult_t wgr;
+    size_t total;
+
+    messages = argc > 1 ? atoi(argv[1]) : 500000;
+    batch = argc > 3 ? atoi(argv[3]) : 0;
+    if (batch > 0)
+        c = channel_of(sizeof(int), capacity);
+    else
+        c = capacity > 0 ? channel_buf(capacity) : channel();
+
+    start = get_timer();
+    wg = waitgroup();
+    go(producer, 1, c);
+    go(producer, 1, c);
+    consumers[0] = go(consumer, 1, c);
+    consumers[1] = go(consumer, 1, c);
+    wgr = waitfor(wg);
+    elapsed = get_timer() - start;
+
+    total = result_for(consumers[0]).max_size + result_for(consumers[1]).max_size;
+    printf("capacity %d, batch %d: %d messages in %.2f ms, %.0f msgs/sec, checksum %s\n",
+           capacity, batch, messages * 2, elapsed / 1e6, messages * 2 / (elapsed / 1e9),
+           total == (size_t)messages * (messages + 1) ? "ok" : "BAD");
+    channel_free(c);
+
+    return 0;
+}
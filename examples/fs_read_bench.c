@@ -0,0 +1,85 @@
+/*
+Benchmark for `coro_fs_*` file calls, against the synchronous stdio path.
+
+    fs_read_bench [readers] [file_kb]
+
+Every reader loads the same file, first one after another with blocking
+`fopen/fread`, then concurrently as coroutines with `coro_fs_read()`, the
+worker's `io_uring` batching their reads, or offload threads where not available.
+*/
+#define USE_CORO
+#include "raii.h"
+
+#define CHUNK (1024 * 1024)
+
+static char path[] = "/tmp/fs_read_bench_XXXXXX";
+static size_t file_size;
+
+static size_t stdio_read(void) {
+    string buf = malloc(file_size);
+    size_t got;
+    FILE *fp = fopen(path, "rb");
+
+    got = fread(buf, 1, file_size, fp);
+    fclose(fp);
+    free(buf);
+
+    return got;
+}
+
+void_t coro_fs_reader(params_t args) {
+    string buf = malloc(CHUNK);
+    size_t got = 0;
+    ssize_t n;
+    int fd = coro_fs_open(path, O_RDONLY, 0);
+
+    while ((n = coro_fs_read(fd, buf, CHUNK, got)) > 0)
+        got += n;
+
+    coro_fs_close(fd);
+    free(buf);
+
+    return casting(got);
+}
+
+int main(int argc, char **argv) {
+    int i, readers = argc > 1 ? atoi(argv[1]) : 16;
+    size_t total, kb = argc > 2 ? (size_t)atol(argv[2]) : 16384;
+    string block = calloc(1, 1024);
+    rid_t *rid = calloc(readers, sizeof(rid_t));
+    uint64_t start, sync_ns, coro_ns;
+    waitgroup_t wg;
+    waitresult_t wgr;
+    FILE *fp;
+
+    file_size = kb * 1024;
+    fp = fdopen(mkstemp(path), "wb");
+    for (i = 0; i < (int)kb; i++)
+        fwrite(block, 1, 1024, fp);
+    fclose(fp);
+    free(block);
+
+    total = 0;
+    start = get_timer();
+    for (i = 0; i < readers; i++)
+        total += stdio_read();
+    sync_ns = get_timer() - start;
+    printf("fopen/fread   %3d readers %10.2f ms   %zu bytes\n", readers, sync_ns / 1e6, total);
+
+    total = 0;
+    start = get_timer();
+    wg = waitgroup();
+    for (i = 0; i < readers; i++)
+        rid[i] = go(coro_fs_reader, 0);
+    wgr = waitfor(wg);
+    coro_ns = get_timer() - start;
+    for (i = 0; i < readers; i++)
+        total += result_for(rid[i]).max_size;
+
+    printf("coro_fs_read  %3d readers %10.2f ms   %zu bytes   speedup %.2f\n",
+           readers, coro_ns / 1e6, total, coro_ns ? (double)sync_ns / coro_ns : 0.0);
+    unlink(path);
+    free(rid);
+
+    return 0;
+}
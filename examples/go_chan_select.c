@@ -0,0 +1,57 @@
+/*
+Same `Golang` example as `go_select`, from https://go.dev/tour/concurrency/5
+using `chan_select`, the waiting coroutine parks on both channels instead of polling.
+*/
+
+#define USE_CORO
+#include "channel.h"
+
+int fibonacci(channel_t c, channel_t quit) {
+    unsigned long tmp;
+    int x = 0;
+    int y = 1;
+    chan_op_t ops[2];
+
+    ops[0].ch = c;
+    ops[0].op = CHAN_SEND;
+    ops[1].ch = quit;
+    ops[1].op = CHAN_RECV;
+    for (;;) {
+        ops[0].value.integer = x;
+        switch (chan_select(ops, 2, -1)) {
+            case 0:
+                tmp = x + y;
+                x = y;
+                y = tmp;
+                break;
+            case 1:
+                puts("quit");
+                return 0;
+        }
+    }
+}
+
+void *func(params_t args) {
+    channel_t c = args[0].object;
+    channel_t quit = args[1].object;
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        printf("%d\n", chan_recv(c).integer);
+    }
+    chan_send(quit, 0);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    channel_t c = channel(), quit = channel();
+    int r;
+
+    go(func, 2, c, quit);
+    r = fibonacci(c, quit);
+    channel_free(c);
+    channel_free(quit);
+
+    return r;
+}
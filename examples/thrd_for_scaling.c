@@ -0,0 +1,50 @@
+/*
+Scaling benchmark for `thrd_for`, runs the same parallel-for with 1..N pool workers.
+
+    thrd_for_scaling [max_workers] [iterations]
+
+Each iteration does a small, uneven amount of work, so chunks finish at
+different times and idle workers have to steal to keep busy.
+*/
+#include "raii.h"
+
+void_t work(i64 start, i64 end) {
+    size_t sum = 0, j;
+    i64 i;
+    for (i = start; i < end; i++) {
+        for (j = 0; j < (size_t)(i % 64) * 16; j++)
+            sum += (j ^ (size_t)i) & 7;
+    }
+
+    return $(casting(sum));
+}
+
+void_t combine(void_t result, size_t id, vectors_t object) {
+    *(size_t *)result += object[0].max_size;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    u32 workers, max_workers = argc > 1 ? (u32)atoi(argv[1]) : (u32)thrd_cpu_count();
+    intptr_t iterations = argc > 2 ? atol(argv[2]) : 2000000;
+    uint64_t start, elapsed, base = 0;
+    size_t total;
+
+    printf("workers      time(ms)   speedup   result\n");
+    for (workers = 1; workers <= max_workers; workers++) {
+        thrd_pool_shutdown();
+        thrd_pool_workers(workers);
+
+        total = 0;
+        start = get_timer();
+        thrd_then(combine, thrd_sync(thrd_for(work, 0, iterations)), &total);
+        elapsed = get_timer() - start;
+        if (workers == 1)
+            base = elapsed;
+
+        printf("%7u %13.2f %9.2f   %zu\n", workers, elapsed / 1e6,
+               elapsed ? (double)base / elapsed : 0.0, total);
+    }
+
+    return 0;
+}
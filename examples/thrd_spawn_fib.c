@@ -13,7 +13,7 @@ void_t fib(args_t args) {
 
         thrd_sync(f);
 
-        return $(thrd_result(x).integer + thrd_result(y).integer);
+        return $(((vectors_t)thrd_result(x).object)[0].integer + ((vectors_t)thrd_result(y).object)[0].integer);
     }
 }
 
@@ -28,7 +28,7 @@ int main(int argc, char **argv) {
     rid_t results = thrd_spawn(fib, 1, casting(n));
 
     thrd_sync(fut);
-    printf("Result: %d\n", thrd_result(results).integer);
+    printf("Result: %d\n", ((vectors_t)thrd_result(results).object)[0].integer);
 
     return 0;
 }
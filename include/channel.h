@@ -5,6 +5,19 @@
 
 typedef _channel_t *channel_t;
 
+typedef enum {
+    CHAN_SEND = 1,
+    CHAN_RECV
+} chan_dir;
+
+/* An `chan_select` operation, `value` to send, or the one received when selected.
+For `channel_of` channels, `value.object` points to the element, or where to receive it. */
+typedef struct chan_op_s {
+    channel_t ch;
+    chan_dir op;
+    template_t value;
+} chan_op_t;
+
 /* Creates an unbuffered channel, similar to golang channels. */
 C_API channel_t channel(void);
 
@@ -12,11 +25,33 @@ C_API channel_t channel(void);
 similar to golang channels. */
 C_API channel_t channel_buf(int);
 
+/* Creates an channel of `elem_size` byte elements, stored inline in it's ring of
+`capacity` elements, `0` for unbuffered. Elements are copied in and out by pointer,
+`chan_send` takes pointer to element, `chan_recv` returns it in `template_t` if it fits. */
+C_API channel_t channel_of(size_t elem_size, int capacity);
+
 /* Send data to the channel. */
 C_API int chan_send(channel_t, void_t);
 
 /* Receive data from the channel. */
 C_API template_t chan_recv(channel_t);
+
+/* Send `n` elements from `elems` array, filling the ring as far as it goes,
+waking an receiver for each, before parking for room. Returns `n`. */
+C_API size_t chan_send_n(channel_t, const void *elems, size_t n);
+
+/* Receive up to `max` elements into `elems` array, parking only for the first,
+then taking what's already there. Returns number received, at least `1`. */
+C_API size_t chan_recv_n(channel_t, void *elems, size_t max);
+
+/* Wait on several channel operations at once, parking current coroutine on all of them,
+until exactly one completes, returns it's position in `ops`.
+A `timeout_ms` of `0` won't wait, negative waits forever,
+returns `-1` when none could complete by then.
+
+This behaves same as GoLang `select {}` statement, with an `time.After` case. */
+C_API int chan_select(chan_op_t ops[], int n, int timeout_ms);
+
 C_API bool chan_ready(channel_t);
 C_API void chan_ready_reset(channel_t);
 C_API void channel_print(channel_t);
@@ -28,7 +63,8 @@ operations. Must be closed out with `selected`,
 and if no `_send(channel, data)`, `_recv(channel, data)`, `_default` provided,
 an infinite loop is created.
 
-This behaves same as GoLang `select {}` statement. */
+This behaves same as GoLang `select {}` statement,
+but keeps polling, `chan_select` parks instead. */
 #define for_select              \
   bool $##__FUNCTION__##_fs;    \
   while (true)  {               \
@@ -26,6 +26,10 @@
 #   undef USE_SJLJ
 #endif
 
+#if defined(USE_MMAP_STACK) && (defined(_WIN32) || defined(_WIN64))
+#   undef USE_MMAP_STACK
+#endif
+
 #if defined(USE_SJLJ)
 /* for sigsetjmp(), sigjmp_buf, and stack_t */
 #define _POSIX_C_SOURCE 200809L
@@ -36,6 +40,12 @@
 #include "future.h"
 #include "hashtable.h"
 
+#if !defined(_WIN32)
+#   include <sys/socket.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#endif
+
 /* Coroutine states. */
 typedef enum {
     CORO_EVENT_DEAD = RAII_ERR, /* The coroutine has ended it's Event Loop routine, is uninitialized or deleted. */
@@ -75,6 +85,92 @@ typedef struct {
 	size_t length;
 } buf_t;
 
+typedef struct {
+    /* coroutines created using an recycled stack. */
+    size_t hits;
+    /* coroutines created needing an fresh stack allocation. */
+    size_t misses;
+    /* recycled stacks released back to the allocator. */
+    size_t trimmed;
+    /* recycled stacks currently held by the calling thread. */
+    size_t cached;
+} stack_pool_stats_t;
+
+typedef struct {
+    /* coroutines this worker stole from others. */
+    size_t stolen;
+    /* coroutines other workers stole from this one. */
+    size_t lost;
+    /* steal rounds this worker tried, while idle. */
+    size_t attempts;
+    /* steal rounds that found nothing to take. */
+    size_t failures;
+} steal_stats_t;
+
+typedef struct {
+    /* time slice expirations delivered, to all workers. */
+    size_t ticks;
+    /* coroutines switched back to the scheduler at an safe point. */
+    size_t preempted;
+    /* time slices that expired again, before an safe point was reached. */
+    size_t overruns;
+    /* expirations that hit while preemption was disabled. */
+    size_t deferred;
+} preempt_stats_t;
+
+typedef struct {
+    /* worker threads counted, main thread included. */
+    size_t workers;
+    /* coroutines resumed by schedulers, context switches. */
+    size_t switches;
+    size_t spawned;
+    size_t completed;
+    /* coroutines stolen, and steal rounds that found nothing to take. */
+    size_t stolen;
+    size_t steal_failures;
+    /* coroutines runnable, waiting in run queues. */
+    size_t queued;
+    /* coroutines waiting on an timer, `sleepfor` or timed park. */
+    size_t sleeping;
+    /* nanoseconds workers spent running coroutines, and parked idle. */
+    size_t run_ns;
+    size_t idle_ns;
+} coro_stats_t;
+
+/* How `coro_affinity` places scheduler worker threads on cpus. */
+typedef enum {
+    /* no pinning, the default */
+    CORO_AFFINITY_NONE,
+    /* worker `n` on `n`th allowed cpu, neighbours share caches */
+    CORO_AFFINITY_COMPACT,
+    /* workers spread evenly over allowed cpus, across sockets and nodes */
+    CORO_AFFINITY_SCATTER,
+    /* compact within an cpu list, like `0-3,8` */
+    CORO_AFFINITY_CPUSET,
+    /* compact within cpus of an NUMA node list, like `0` or `0,2` */
+    CORO_AFFINITY_NODE
+} coro_affinity_t;
+
+/* Run queue class of an coroutine, like `nice` values, lower runs first. */
+typedef enum {
+    CORO_PRIORITY_HIGH = -1,
+    CORO_PRIORITY_NORMAL = 0,
+    CORO_PRIORITY_LOW = 1
+} coro_priority_t;
+
+typedef enum {
+    CORO_TRACE_SPAWN,
+    CORO_TRACE_SWITCH,
+    CORO_TRACE_YIELD,
+    CORO_TRACE_SLEEP,
+    CORO_TRACE_WAKE,
+    CORO_TRACE_STEAL,
+    CORO_TRACE_TAKE,
+    CORO_TRACE_TRANSFER,
+    CORO_TRACE_GROUP_DONE,
+    CORO_TRACE_CHAN_BLOCK
+} coro_trace_kind;
+
 #if defined(USE_UCONTEXT)
 #define _BSD_SOURCE
 #if __APPLE__ && __MACH__
@@ -126,7 +222,10 @@ C_API int swapcontext(ucontext_t *, const ucontext_t *);
 
 #ifndef CORO_STACK_SIZE
 /* Stack size when creating a coroutine. */
-#if defined(USE_UCONTEXT)
+#if defined(USE_MMAP_STACK)
+/* Only reserved address space, pages are committed by the kernel on first touch. */
+#   define CORO_STACK_SIZE (256 * 1024)
+#elif defined(USE_UCONTEXT)
 #   define CORO_STACK_SIZE (16 * 1024)
 #else
 #   define CORO_STACK_SIZE (16 * 1024)
@@ -137,6 +236,100 @@ C_API int swapcontext(ucontext_t *, const ucontext_t *);
 #   define SCRAPE_SIZE (2 * 64)
 #endif
 
+#ifndef CORO_POOL_CLASSES
+/* Number of stack size classes in each thread's coroutine stack pool,
+starting at `CORO_STACK_SIZE` and doubling per class. */
+#   define CORO_POOL_CLASSES 6
+#endif
+
+#ifndef CORO_POOL_LIMIT
+/* Max recycled stacks held per size class, per thread. */
+#   define CORO_POOL_LIMIT 1024
+#endif
+
+#ifndef CORO_PARK_SPIN
+/* Times an idle scheduler thread spins checking for work, before parking. */
+#   define CORO_PARK_SPIN 64
+#endif
+
+#ifndef CORO_PARK_TIMEOUT
+/* Max milliseconds an idle scheduler thread stays parked, before rechecking. */
+#   define CORO_PARK_TIMEOUT 100
+#endif
+
+/* Claim value `coro_park_for` timer swaps in, when it's deadline passes first. */
+#define CORO_PARK_EXPIRED ((size_t)-1)
+
+#ifndef CORO_WORKERS
+/* Scheduler threads, main thread included, `0` for one per cpu core, plus one. */
+#   define CORO_WORKERS 0
+#endif
+
+#ifndef CORO_WORKERS_MAX
+/* Most scheduler threads environment `CORO_WORKERS` can ask for. */
+#   define CORO_WORKERS_MAX 1024
+#endif
+
+#ifndef CORO_INLINE_ARGS
+/* Arguments `go`, `launch` and `async` store within coroutine, more use an heap array. */
+#   define CORO_INLINE_ARGS 4
+#endif
+
+#ifndef CORO_PRIORITY_AGING
+/* Times an waiting lower run queue class is passed over, before it's next coroutine runs. */
+#   define CORO_PRIORITY_AGING 8
+#endif
+
+#ifndef CORO_STEAL_BACKOFF
+/* Failed steal rounds an idle worker backs off by yielding, doubling each round, before parking. */
+#   define CORO_STEAL_BACKOFF 4
+#endif
+
+#ifndef CORO_REACTOR_EVENTS
+/* Readiness events an worker's reactor collects, in one `epoll_wait` batch. */
+#   define CORO_REACTOR_EVENTS 64
+#endif
+
+#ifndef CORO_REACTOR_TICK
+/* Coroutines dispatched between reactor polls, while fds are waited on and others are runnable. */
+#   define CORO_REACTOR_TICK 32
+#endif
+
+#ifndef CORO_RING_ENTRIES
+/* Submission queue size of an worker's `io_uring`, for `coro_fs_*` requests. */
+#   define CORO_RING_ENTRIES 64
+#endif
+
+#ifndef CORO_FS_THREADS
+/* Blocking offload threads `coro_fs_*` requests use, where `io_uring` is not available. */
+#   define CORO_FS_THREADS 4
+#endif
+
+#ifndef CORO_PREEMPT_USECS
+/* Default preemption time slice, in microseconds of worker thread CPU time. */
+#   define CORO_PREEMPT_USECS 10000
+#endif
+
+#ifndef CORO_POOL_IDLE
+/* Recycled stacks kept per size class, after an idle thread trims it's pool. */
+#   define CORO_POOL_IDLE 16
+#endif
+
+#ifndef CORO_PROFILE_SLOTS
+/* Distinct coroutine names the profiler tracks per thread, others are counted as `[other]`. */
+#   define CORO_PROFILE_SLOTS 256
+#endif
+
+#ifndef CORO_TRACE_EVENTS
+/* Default events kept per thread by `coro_trace_start`, oldest overwritten first. */
+#   define CORO_TRACE_EVENTS 65536
+#endif
+
+#ifndef CORO_PROFILE_BUCKETS
+/* Run slice histogram buckets, first under 1 microsecond, each next doubling. */
+#   define CORO_PROFILE_BUCKETS 16
+#endif
+
 /* Number used only to assist checking for stack overflows. */
 #define CORO_MAGIC_NUMBER 0x7E3CB1A9
 
@@ -226,6 +419,15 @@ extern "C" {
     and add to schedular, same behavior as Go. */
     C_API rid_t go(callable_t, u64, ...);
 
+    /* Creates an coroutine like `go`, placed in run queue class `priority`,
+    `CORO_PRIORITY_HIGH` runs ahead of others, `CORO_PRIORITY_LOW` only when idle,
+    or passed over `CORO_PRIORITY_AGING` times. */
+    C_API rid_t go_priority(coro_priority_t priority, callable_t, u64, ...);
+
+    /* Creates an coroutine like `go`, due within `ms` milliseconds,
+    these run ahead of every class, earliest deadline first. */
+    C_API rid_t go_deadline(u32 ms, callable_t, u64, ...);
+
     /* Returns results of an completed coroutine, by `result id`, will panic,
     if called before `waitfor` returns. */
     C_API template result_for(rid_t);
@@ -300,6 +502,8 @@ extern "C" {
     /* Collect coroutines with references preventing immediate cleanup. */
     C_API void coro_gc(routine_t *);
     C_API routine_t *coro_ref_current(void);
+    /* Referenced current coroutine, only resumed by `coro_wake` till then. */
+    C_API routine_t *coro_park_current(void);
     C_API void coro_ref(routine_t *);
     C_API void coro_unref(routine_t *);
 
@@ -331,7 +535,71 @@ extern "C" {
 
     /* Check for at least `n` bytes left on the stack. If not present, panic/abort. */
     C_API void coro_stack_check(int);
+
+    /* Return coroutine stack pool `hits`, `misses` and `trimmed` counts for all threads,
+    and number of stacks the calling thread have `cached` for reuse. */
+    C_API stack_pool_stats_t coro_stack_pool_stats(void);
+
+    /* Release recycled coroutine stacks of calling thread back to the allocator,
+    keeping at most `keep` per size class. */
+    C_API void coro_stack_pool_trim(u32 keep);
+
+    /* Return work stealing counters of worker thread `thrd_id`,
+    all zero if not threading or `thrd_id` out of range. */
+    C_API steal_stats_t coro_steal_stats(u32 thrd_id);
+
+    /* Return scheduler counters summed over all worker threads, each keeps it's own
+    counter block, reading them takes no locks and doesn't stop any worker. */
+    C_API coro_stats_t coro_stats_snapshot(void);
+    /* Return scheduler counters of worker thread `thrd_id`, all zero if out of range. */
+    C_API coro_stats_t coro_stats_worker(u32 thrd_id);
+    /* Write an `coro_stats_snapshot`, and each worker's counters, as one JSON line to `out`. */
+    C_API void coro_stats_print(FILE *out);
+    /* Start an thread writing `coro_stats_print` to `out` every `ms` milliseconds,
+    replacing any previous one, an `ms` of `0` stops it. */
+    C_API void coro_stats_every(FILE *out, u32 ms);
+
+    /* Set number of scheduler threads, main thread included, taking effect when
+    scheduler starts, `0` restores `CORO_WORKERS` default, or environment `CORO_WORKERS`. */
+    C_API void coro_workers(u32 count);
+    /* Pin scheduler worker threads by `policy`, taking effect when scheduler starts,
+    `list` are cpus for `CORO_AFFINITY_CPUSET`, NUMA nodes for `CORO_AFFINITY_NODE`.
+    Without, environment `CORO_AFFINITY` is used: `compact`, `scatter`, `cpuset:0-3` or `node:0`.
+
+    Main thread isn't pinned, threads it creates afterwards would inherit it. Each worker
+    allocates it's `deque`, and coroutine stacks, after pinning, placed on it's local node. */
+    C_API void coro_affinity(coro_affinity_t policy, string_t list);
+    /* Return cpu worker thread `thrd_id` is pinned to, `RAII_ERR` if not pinned. */
+    C_API int coro_thrd_cpu(u32 thrd_id);
+
+    /* Start sampling how long each coroutine runs before switching back to it's scheduler,
+    per thread, by `coro_name`, or function address if unnamed. Clears earlier samples,
+    slices longer than `threshold_us` microseconds are flagged as slow, `0` for none. */
+    C_API void coro_profile_start(u32 threshold_us);
+    C_API void coro_profile_stop(void);
+    /* Write samples in folded stack format, `thread;name` or `thread;name;[slow]`
+    followed by microseconds, input for `flamegraph.pl` and speedscope. */
+    C_API void coro_profile_folded(FILE *out);
+    /* Write samples per thread and name, with run slice histogram. */
+    C_API void coro_profile_report(FILE *out);
+
+    /* Start recording scheduler events into per thread rings of `events` entries,
+    `CORO_TRACE_EVENTS` if `0`. Clears earlier events. */
+    C_API void coro_trace_start(u32 events);
+    C_API void coro_trace_stop(void);
+    /* Record `kind` event for current coroutine, with an event specific `arg`. */
+    C_API void coro_trace(coro_trace_kind kind, u32 arg);
+    /* Write recorded events as Chrome trace event JSON, loads in Perfetto or `chrome://tracing`.
+    Call after `coro_trace_stop`, rings still being written may show torn events. */
+    C_API void coro_trace_dump(FILE *out);
     C_API void coro_enqueue(routine_t *);
+    /* Resume coroutine parked with `coro_suspend`, from any thread,
+    it's added to run queue of the thread it was parked on. */
+    C_API void coro_wake(routine_t *);
+    /* Suspend coroutine from `coro_park_current`, till an `coro_wake` or `ms` passes.
+    Wakers and the timer race swapping `claim` from `0`, only the winner resumes it,
+    returns `false` when timer won, `claim` then holds `CORO_PARK_EXPIRED`. */
+    C_API bool coro_park_for(atomic_size_t *claim, u32 ms);
 
     /* Suspends the execution of current coroutine, switch to scheduler. */
     C_API void coro_suspend(void);
@@ -470,10 +738,55 @@ extern "C" {
     C_API int coro_main(int, char **);
     C_API int raii_main(int, char **);
 
+    /* Start preemption, every worker thread gets its own `usecs` time slice timer,
+    counting the thread's CPU time, default `CORO_PREEMPT_USECS` if `0`.
+
+    An coroutine whose time slice expired is switched back to the scheduler
+    at the next safe point, `preempt_check()`, the last `preempt_enable()`,
+    `malloc_local/calloc_local` or `raii_defer/deferring`.
+    Code not reaching any, is never switched. */
     C_API void preempt_init(u32 usecs);
+    /* Nestable, stop the current worker from being preempted. */
     C_API void preempt_disable(void);
+    /* Reverse `preempt_disable()`, an safe point once preemption is enabled again. */
     C_API void preempt_enable(void);
+    /* Safe point, yield if current coroutine time slice expired, returns `true` if it did. */
+    C_API bool preempt_check(void);
     C_API void preempt_stop(void);
+    /* Return preemption counters for all threads. */
+    C_API preempt_stats_t preempt_stats(void);
+
+#if !defined(_WIN32)
+    /* Read from non-blocking `fd`, current coroutine parks in the worker's reactor,
+    until readable, other coroutines keep running.
+
+    Any of these waits ends early by `coro_enqueue` on parked coroutine,
+    returning `-1` with `errno` set to `ECANCELED`. */
+    C_API ssize_t coro_read(int fd, void_t buf, size_t n);
+    /* Write all `n` bytes to non-blocking `fd`, parking while it's not writable,
+    returns bytes written, `-1` if error before any. */
+    C_API ssize_t coro_write(int fd, const void_t buf, size_t n);
+    /* Accept connection on non-blocking listening socket, parking until one arrives,
+    returned socket is non-blocking. */
+    C_API int coro_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+    /* Connect non-blocking socket, parking until completed, returns `0` or `-1` with `errno`. */
+    C_API int coro_connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+    /* Set `O_NONBLOCK` on `fd`, required by `coro_read`/`coro_write`. */
+    C_API int coro_nonblock(int fd);
+
+    /* Open file `path`, current coroutine parks until the worker's `io_uring`,
+    or an blocking offload thread completes it, returns fd or `-1` with `errno`.
+    Outside coroutines, all `coro_fs_*` calls are plain blocking system calls. */
+    C_API int coro_fs_open(string_t path, int flags, u32 mode);
+    /* Read up to `n` bytes at `offset`, `-1` for current file position. */
+    C_API ssize_t coro_fs_read(int fd, void_t buf, size_t n, i64 offset);
+    /* Write up to `n` bytes at `offset`, `-1` for current file position. */
+    C_API ssize_t coro_fs_write(int fd, const void_t buf, size_t n, i64 offset);
+    C_API int coro_fs_fsync(int fd);
+    C_API int coro_fs_stat(string_t path, struct stat *st);
+    C_API int coro_fs_fstat(int fd, struct stat *st);
+    C_API int coro_fs_close(int fd);
+#endif
 
 	C_API string cin(size_t length);
 
@@ -99,6 +99,7 @@ typedef struct ex_backtrace_s ex_backtrace_t;
 typedef void (*ex_setup_func)(ex_context_t *, const char *, const char *);
 typedef void (*ex_terminate_func)(void);
 typedef void (*ex_unwind_func)(void *);
+typedef bool (*ex_guard_func)(void *);
 
 /* low-level api
  */
@@ -300,6 +301,9 @@ C_API ex_setup_func exception_setup_func;
 C_API ex_unwind_func exception_unwind_func;
 C_API ex_terminate_func exception_terminate_func;
 C_API ex_terminate_func exception_ctrl_c_func;
+/* Checks faulting address of `SIGSEGV/SIGBUS` for an stack guard page hit,
+if `true` the signal is raised as `stack_overflow` exception. */
+C_API ex_guard_func exception_guard_func;
 C_API bool exception_signal_set;
 
 /* pointer protection
@@ -4,6 +4,28 @@
 
 #include "rtypes.h"
 
+#ifndef THRD_POOL_SIZE
+/* Worker threads `thrd_async` and `thrd_spawn` jobs run on, created on first use,
+`0` for one per cpu core. */
+#   define THRD_POOL_SIZE 0
+#endif
+
+#ifndef THRD_POOL_QUEUE
+/* Initial capacity of each pool worker's jobs queue, doubles when full. */
+#   define THRD_POOL_QUEUE 64
+#endif
+
+#ifndef THRD_FOR_CHUNKS
+/* Chunks per pool worker `thrd_for` splits a range into, extra chunks let
+idle workers steal from busy ones, when iterations cost differs. */
+#   define THRD_FOR_CHUNKS 4
+#endif
+
+#ifndef THRD_FOR_GRAIN
+/* Minimum iterations per `thrd_for` chunk. */
+#   define THRD_FOR_GRAIN 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -38,6 +60,14 @@ C_API void thrd_until(future);
 any call thereafter to `thrd_get` is guaranteed non-blocking. */
 C_API bool thrd_is_done(future);
 C_API void thrd_delete(future);
+
+/* Stop and join pool worker threads, after finishing any job running,
+called at exit, the pool starts again on next `thrd_async` or `thrd_spawn`. */
+C_API void thrd_pool_shutdown(void);
+
+/* Set number of pool worker threads, taking effect on pool's next start,
+`0` restores `THRD_POOL_SIZE` default. */
+C_API void thrd_pool_workers(u32 count);
 C_API uintptr_t thrd_self(void);
 C_API size_t thrd_cpu_count(void);
 
@@ -62,7 +92,10 @@ C_API rid_t thrd_spawn(thrd_func_t fn, size_t, ...);
 C_API template_t thrd_result(rid_t id);
 C_API void thrd_set_result(raii_values_t *, int);
 
-C_API future_t thrd_for(for_func_t loop, intptr_t initial, intptr_t times);
+/* Run ~loop~ over `initial` to `initial + times`, split into `[start, end)` chunks,
+on all pool workers, sized `times / (workers * THRD_FOR_CHUNKS)`, at least `THRD_FOR_GRAIN`.
+Each chunk's returned value, like from `$()`, is combined with `thrd_then(callback, thrd_sync(...))`. */
+C_API future_t thrd_for(range_func_t loop, intptr_t initial, intptr_t times);
 
 C_API void thrd_then(result_func_t callback, future_t iter, void_t result);
 C_API void thrd_destroy(future_t);
@@ -38,6 +38,10 @@ C_API bool hash_string_eq(const_t, const_t, void_t arg);
 /* General string copy */
 C_API void_t hash_string_cp(const_t, void_t arg);
 
+/* Pairs are taken from an `raii_pool_t`. An thread started by `thrd_create` that puts or
+removes pairs must call `raii_pool_flush` before it returns, otherwise up to
+`RAII_POOL_BATCH * 2 - 1` freed pairs stay cached by the exited thread.
+Future pool, and coroutine worker threads already do. */
 C_API hash_t *hashtable_init(key_ops_t key_ops, val_ops_t val_ops, probe_func probing, u32 cap);
 C_API hash_t *hash_create(void);
 C_API hash_t *hash_create_ex(u32);
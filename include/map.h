@@ -33,6 +33,8 @@ typedef enum {
      of_func,
 } array_type;
 
+/* Items are taken from an `raii_pool_t`, like `hash_t` pairs. An thread started by `thrd_create`
+using maps must call `raii_pool_flush` before it returns, or freed items stay cached by it. */
 C_API map_t maps(void);
 C_API map_t map_create(void);
 C_API map_t map_for(u32 num_of_pairs, ...);
@@ -24,6 +24,68 @@
 #   define O_BINARY 0
 #endif
 
+#ifndef RAII_ARENA_BLOCK
+/* Bytes in each chunk of an scope's `malloc_arena` region,
+requests over a quarter of this get an chunk of their own. */
+#   define RAII_ARENA_BLOCK 8192
+#endif
+
+#ifndef RAII_DEFER_INLINE
+/* `defer` records an scope holds itself, more spill to an heap array. */
+#   define RAII_DEFER_INLINE 8
+#endif
+
+#ifndef RAII_POOL_BATCH
+/* Objects an thread's `raii_pool_t` cache takes, or hands back, at once. */
+#   define RAII_POOL_BATCH 32
+#endif
+
+#ifndef RAII_POOL_MAX
+/* Pools each thread keeps an cache for, more pools use `malloc` directly. */
+#   define RAII_POOL_MAX 32
+#endif
+
+/* Fixed size object pool, declare `static`, initialized by `RAII_POOL_INIT`,
+pools live for the process, memory is recycled, never released. */
+typedef struct raii_pool_s raii_pool_t;
+struct raii_pool_s {
+    string_t name;
+    size_t size;
+    /* thread cache index plus one, `0` until first use */
+    atomic_size_t slot;
+    atomic_spinlock lock;
+    /* batches handed back by threads, and chunks objects are carved from */
+    void_t shared;
+    void_t chunks;
+    size_t spare;
+    size_t capacity;
+    size_t chunk_count;
+    atomic_size_t in_use;
+};
+#define RAII_POOL_INIT(name, type) {name, sizeof(type)}
+
+typedef struct {
+    string_t name;
+    /* bytes per object, as rounded by pool. */
+    size_t size;
+    /* objects carved from chunks, and number of chunks. */
+    size_t capacity;
+    size_t chunks;
+    /* objects handed out, not yet returned, other threads report theirs each `RAII_POOL_BATCH`. */
+    size_t in_use;
+    /* objects in pool's shared batches, and calling thread's cache. */
+    size_t shared;
+    size_t cached;
+} raii_pool_stats_t;
+
+/* Chunk of an scope's region, `malloc_arena` bumps `used` until full. */
+typedef struct raii_arena_s raii_arena_t;
+struct raii_arena_s {
+    raii_arena_t *next;
+    size_t used;
+    size_t size;
+};
+
 struct memory_s {
     void_t arena;
     raii_type status;
@@ -38,6 +100,10 @@ struct memory_s {
     void_t volatile err;
     string_t volatile panic;
     raii_deque_t *queued;
+    raii_arena_t *region;
+    /* promises allocating in scope, from spawning thread and pool workers */
+    atomic_spinlock promise_lock;
+    defer_func_t defer_inline[RAII_DEFER_INLINE];
 };
 
 struct _promise {
@@ -59,7 +125,7 @@ struct _future_arg {
     promise *value;
     raii_deque_t *queue;
 };
-make_atomic(worker_t, atomic_worker_t)
+make_atomic(worker_t *, atomic_worker_t)
 
 typedef struct {
     atomic_size_t size;
@@ -67,11 +133,27 @@ typedef struct {
 } future_array_t;
 make_atomic(future_array_t *, atomic_future_t)
 
+/* Result slots per page, pages are allocated on demand and never move. */
+#define RAII_RESULT_PAGE 1024
+/* Low `rid_t` bits holding slot index, remaining high bits hold slot generation,
+bumped each time slot is recycled, so stale ids are detected. */
+#define RAII_RESULT_BITS 22
+#define RAII_RESULT_LIMIT (1u << RAII_RESULT_BITS)
+#define RAII_RESULT_PAGES (RAII_RESULT_LIMIT / RAII_RESULT_PAGE)
+#define RAII_RESULT_INDEX(rid) ((rid) & (RAII_RESULT_LIMIT - 1))
+/* Freed slots are reused oldest first, only once this many wait, so an slot's
+generation goes around after at least `RAII_RESULT_REUSE << (32 - RAII_RESULT_BITS)` frees. */
+#define RAII_RESULT_REUSE RAII_RESULT_PAGE
+
 typedef struct result_data {
     raii_type type;
     bool is_ready;
     rid_t id;
+    /* next free slot index + 1, while on free list */
+    u32 next;
     raii_values_t *result;
+    /* inline storage for `result`, unless externally owned */
+    raii_values_t value;
 } _result_t, *result_t;
 make_atomic(result_t, atomic_result_t)
 
@@ -120,11 +202,15 @@ struct raii_results_s {
     /* coroutine unique id */
     atomic_size_t id_generate;
 
-    /* result generator also used to determent which thread's `run queue`
-    receive next `coroutine` task, `counter % cpu cores` */
+    /* result slot high-water mark, slots below are allocated */
     atomic_size_t result_id_generate;
     atomic_size_t take_count;
-    atomic_result_t *results;
+    /* recycled result slots queue, `index + 1` of oldest and newest */
+    atomic_spinlock result_lock;
+    u32 result_head, result_tail;
+    atomic_size_t result_free;
+    /* pages of `RAII_RESULT_PAGE` result slots */
+    atomic_result_t results[RAII_RESULT_PAGES];
 };
 
 struct _future {
@@ -154,8 +240,16 @@ C_API void raii_unwind_set(ex_context_t *ctx, const char *ex, const char *messag
 C_API int raii_deferred_init(defer_t *array);
 
 C_API result_t raii_result_create(void);
+
+/* Return `result` for `rid`, or an never ready empty `result` if `rid` is stale. */
 C_API result_t raii_result_get(rid_t);
 
+/* Recycle `result` slot of `rid`, any further use of `rid` is stale. */
+C_API void raii_result_free(rid_t);
+
+/* Release all `result` pages, at exit. */
+C_API void raii_result_destroy(void);
+
 /* Check status of an `result id` */
 C_API bool result_is_ready(rid_t);
 
@@ -208,6 +302,33 @@ C_API void_t malloc_full(memory_t *scope, size_t size, func_t func);
 DO NOT `free`, will be freed with given `func`, when scope smart pointer panics/returns/exits. */
 C_API void_t calloc_full(memory_t *scope, int count, size_t size, func_t func);
 
+/* Request/return raw memory of given `size`, bump allocated from scope smart pointer's region.
+DO NOT `free`, no `defer` is recorded, the whole region is released after scope's
+`raii_deferred` statements run, when scope smart pointer panics/returns/exits. */
+C_API void_t malloc_arena(memory_t *scope, size_t size);
+
+/* Same as `malloc_arena`, but zeroed. */
+C_API void_t calloc_arena(memory_t *scope, int count, size_t size);
+
+/* Return zeroed object of `pool`, from calling thread's cache,
+refilled an batch at a time. Will `throw/panic` if memory request fails. */
+C_API void_t raii_pool_alloc(raii_pool_t *pool);
+
+/* Return `ptr` to calling thread's cache of `pool`, any thread can return
+objects of any other, an full cache hands an batch back to `pool`. */
+C_API void raii_pool_free(raii_pool_t *pool, void_t ptr);
+
+/* Hand calling thread's cached objects of all pools back, before thread exits.
+Not called automatically for `thrd_create` threads, up to `RAII_POOL_BATCH * 2 - 1`
+objects per pool stay with an exited thread that didn't. */
+C_API void raii_pool_flush(void);
+
+/* Return occupancy counters of `pool`. */
+C_API raii_pool_stats_t raii_pool_stats(raii_pool_t *pool);
+
+/* Write `raii_pool_stats` of every pool in use, as one JSON line to `out`. */
+C_API void raii_pool_print(FILE *out);
+
 /* Same as `raii_deferred_free`, but also destroy smart pointer. */
 C_API void raii_delete(memory_t *ptr);
 
@@ -245,6 +366,8 @@ inside `thread/future`, or active `coroutine` call. */
 C_API void_t calloc_local(int count, size_t size);
 
 C_API template_t *value_create(const_t, raii_type);
+/* Same as `value_create`, but sets given zeroed `value`. */
+C_API template_t *value_init(template_t *value, const_t, raii_type);
 C_API template_t raii_value(void_t);
 C_API raii_type type_of(void_t);
 C_API bool is_type(void_t, raii_type);
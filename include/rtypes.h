@@ -268,6 +268,7 @@ typedef union {
     char buffer[64];
 } template_t, *vectors_t, *args_t;
 typedef void (*for_func_t)(i64, i64);
+typedef void_t(*range_func_t)(i64 start, i64 end);
 typedef void_t(*result_func_t)(void_t result, size_t id, vectors_t iter);
 typedef void_t(*thrd_func_t)(args_t);
 typedef void (*wait_func)(void);
@@ -7,6 +7,20 @@
 extern "C" {
 #endif
 
+/* Header stored before first `vector/array` item. */
+typedef struct vector_metadata_s {
+    raii_type type;
+    int defer_set;
+    size_t size;
+    size_t capacity;
+    func_t destructor;
+    memory_t *context;
+} vector_metadata_t;
+
+/* `template` items an `array_inline` buffer needs, for `count` values and header. */
+#define ARRAY_INLINE_SLOTS(count) \
+    ((count) + (sizeof(vector_metadata_t) + sizeof(template) - 1) / sizeof(template))
+
 C_API vectors_t vector_variant(void);
 C_API vectors_t vector_for(vectors_t, size_t, ...);
 C_API void vector_insert(vectors_t, size_t, void_t);
@@ -54,7 +68,15 @@ C_API bool is_args(void_t);
 */
 C_API arrays_t array_of(memory_t *, size_t, ...);
 C_API arrays_t array_ex(memory_t *, size_t, va_list);
+
+/* Same as `array_ex`, but built in caller's `buffer` of `size` bytes, header included,
+never freed or deferred, if it grows, it's copied to heap, deferred in given `scope`.
+Returns `nullptr` if arguments won't fit. */
+C_API arrays_t array_inline(void_t buffer, size_t size, memory_t *, size_t, va_list);
 C_API arrays_t array_copy(arrays_t des, arrays_t src);
+/* Grow `arr` to hold at least `count` items, at least doubling, returns it, moved if grown.
+`$append` can't return an moved array, reserve before, and before `array_deferred_set`. */
+C_API arrays_t array_reserve(arrays_t arr, size_t count);
 C_API void array_deferred_set(arrays_t, memory_t *);
 C_API void array_append(arrays_t, void_t);
 C_API template array_pop(arrays_t arr);
@@ -1,393 +1,487 @@
 #include "channel.h"
 #include "reflection.h"
 
+/*
+ * Channels are shared by coroutines on any scheduler thread.
+ *
+ * Buffered channels are a bounded MPMC ring, modified from Dmitry Vyukov's
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ * every slot has an sequence number, telling senders and receivers
+ * which lap of the ring it's on, no locks taken while not full or empty.
+ * Slot payloads of `elem_size` bytes are stored inline, right after it.
+ * Sequence numbers are doubled, `2 * pos` free and `2 * pos + 1` filled,
+ * so they can't collide on an ring of one slot.
+ *
+ * Coroutines that can't proceed park in the channel's waiter queue,
+ * taken under `lock`, and are resumed with `coro_wake()` onto the thread they parked on.
+ * Parking side counts itself in `*_waiting` before it's last try on the ring,
+ * the other side checks the count after it's ring operation, so one always sees the other.
+ *
+ * Unbuffered channels have no ring, values are handed from sender to receiver directly.
+ *
+ * `chan_select()` locks all it's channels in address order, then queues one waiter
+ * on each, sharing an claim word, wakers swap it to take the waiter, skipping any
+ * already claimed through another channel.
+ */
 typedef struct {
     hash_t *gc;
 } chan_gc_t;
-thrd_static(int, chan_id_gen, 0)
-thrd_static(chan_gc_t, chan, nullptr)
+static atomic_spinlock chan_gc_lock;
+static chan_gc_t chan_gc_registry = {nullptr};
+static atomic_size_t chan_id_gen = 0;
 static char error_message[SCRAPE_SIZE] = {0};
 
 typedef struct channel_co_s channel_co_t;
 typedef struct msg_queue_s msg_queue_t;
+typedef struct chan_slot_s chan_slot_t;
+
+/* Parked coroutine, lives on it's own stack while waiting. */
+struct channel_co_s {
+    routine_t *co;
+    /* element to send, or where to receive into */
+    void *v;
+    /* value handed over, unbuffered channels only */
+    volatile bool done;
+    /* `chan_select` claim, shared by all it's waiters, `nullptr` otherwise */
+    atomic_size_t *sel;
+    /* op position in `chan_select`, claim becomes `index + 1` */
+    size_t index;
+    channel_co_t *next;
+};
+
 struct msg_queue_s {
-    channel_co_t **a;
-    u32 n;
-    u32 m;
+    channel_co_t *head;
+    channel_co_t *tail;
+};
+
+/* Ring slot header, `elem_size` bytes of payload follow inline. */
+struct chan_slot_s {
+    atomic_size_t seq;
 };
 
+/* Payload alignment, enough for any scalar type. */
+#define CHAN_ALIGN 16
+#define chan_slot(c, pos) ((chan_slot_t *)((c)->buf + ((pos) % (c)->bufsize) * (c)->slot_size))
+#define chan_slot_data(slot) ((char *)(slot) + sizeof(chan_slot_t))
+
 struct channel_s {
     raii_type type;
     bool select_ready;
+    /* `channel/channel_buf`, elements are `raii_values_t` boxing caller's pointer,
+    otherwise `channel_of`, caller's elements copied inline */
+    bool boxed;
     u32 bufsize;
     u32 elem_size;
-    u32 nbuf;
-    u32 off;
+    /* slot header plus `elem_size`, rounded up to keep payloads aligned */
+    u32 slot_size;
     u32 id;
     char *name;
-    unsigned char *buf;
+    char *buf;
+    cacheline_pad_t _pad;
+    /* next ring position to send into */
+    atomic_size_t head;
+    cacheline_pad_t _pad_;
+    /* next ring position to receive from */
+    atomic_size_t tail;
+    cacheline_pad_t pad;
+    atomic_spinlock lock;
+    atomic_size_t send_waiting;
+    atomic_size_t recv_waiting;
     msg_queue_t a_send;
     msg_queue_t a_recv;
-    raii_values_t *data;
-};
-
-struct channel_co_s {
-    channel_t c;
-    void_t v;
-    u32 op;
-    routine_t *co;
-    channel_co_t *x_msg;
-};
-
-enum {
-    CHANNEL_END,
-    CHANNEL_SEND,
-    CHANNEL_RECV,
-    CHANNEL_OP,
-    CHANNEL_BLK,
 };
 
 static void chan_gc(channel_t ch) {
-    if (is_chan_empty()) {
-        chan_gc_t *gc = try_calloc(1, sizeof(chan_gc_t));
-        gc->gc = hash_create();
-        chan_update(gc);
-    }
+    atomic_lock(&chan_gc_lock);
+    if (is_empty(chan_gc_registry.gc))
+        chan_gc_registry.gc = hash_create();
 
-    if (is_type(ch, RAII_CHANNEL))
-        hash_put(chan()->gc, simd_itoa(ch->id, error_message), ch);
+    hash_put(chan_gc_registry.gc, simd_itoa(ch->id, error_message), ch);
+    atomic_unlock(&chan_gc_lock);
 }
 
-static channel_t channel_create(int elem_size, int bufsize) {
-    channel_t c = try_calloc(1, sizeof(struct channel_s) + bufsize * elem_size);
-    raii_values_t *s = try_calloc(1, sizeof(raii_values_t));
+static channel_t channel_create(size_t elem_size, int bufsize, bool boxed) {
+    u32 slot_size = (u32)((sizeof(chan_slot_t) + elem_size + CHAN_ALIGN - 1)
+                          & ~(CHAN_ALIGN - 1));
+    channel_t c;
+    u32 i;
 
-    c->id = ++*chan_id_gen();
-    c->elem_size = elem_size;
+    if (elem_size == 0 || bufsize < 0)
+        raii_panic("channel element size must be positive, and capacity not negative");
+
+    c = try_calloc(1, sizeof(struct channel_s) + CHAN_ALIGN + (size_t)bufsize * slot_size);
+    c->id = (u32)atomic_fetch_add(&chan_id_gen, 1) + 1;
+    c->elem_size = (u32)elem_size;
+    c->slot_size = slot_size;
     c->bufsize = bufsize;
-    c->nbuf = 0;
-    c->data = s;
     c->select_ready = false;
-    c->buf = (unsigned char *)(c + 1);
+    c->boxed = boxed;
+    c->buf = (char *)(((uintptr_t)(c + 1) + CHAN_ALIGN - 1) & ~(uintptr_t)(CHAN_ALIGN - 1));
+    for (i = 0; i < c->bufsize; i++)
+        atomic_init(&chan_slot(c, i)->seq, (size_t)i * 2);
+
+    atomic_init(&c->head, 0);
+    atomic_init(&c->tail, 0);
+    atomic_init(&c->send_waiting, 0);
+    atomic_init(&c->recv_waiting, 0);
+    atomic_flag_clear(&c->lock);
     c->type = RAII_CHANNEL;
 
     chan_gc(c);
     return c;
 }
 
-RAII_INLINE void channel_destroy(void) {
-    if (!is_chan_empty()) {
-        chan_gc_t *gc = chan();
-        hash_free(gc->gc);
-        free(gc);
-        chan_update(nullptr);
+void channel_destroy(void) {
+    atomic_lock(&chan_gc_lock);
+    if (!is_empty(chan_gc_registry.gc)) {
+        hash_free(chan_gc_registry.gc);
+        chan_gc_registry.gc = nullptr;
     }
+    atomic_unlock(&chan_gc_lock);
 }
 
 RAII_INLINE channel_t channel(void) {
-    return channel_create(sizeof(raii_values_t), 0);
+    return channel_create(sizeof(raii_values_t), 0, true);
 }
 
 RAII_INLINE channel_t channel_buf(int elem_count) {
-    return channel_create(sizeof(raii_values_t), elem_count);
+    return channel_create(sizeof(raii_values_t), elem_count, true);
+}
+
+RAII_INLINE channel_t channel_of(size_t elem_size, int capacity) {
+    return channel_create(elem_size, capacity, false);
 }
 
 void channel_free(channel_t c) {
+    u32 id;
     if (!is_empty(c) && is_type(c, RAII_CHANNEL)) {
         c->type = -1;
-        int id = c->id;
+        id = c->id;
         if (!is_empty(c->name))
             free(c->name);
 
-        free(c->data);
-        free(c->a_recv.a);
-        free(c->a_send.a);
         memset(c, 0, sizeof(raii_type));
         free(c);
 
-        if (hash_count(chan()->gc) > 0)
-            hash_delete(chan()->gc, simd_itoa(id, error_message));
+        atomic_lock(&chan_gc_lock);
+        if (!is_empty(chan_gc_registry.gc) && hash_count(chan_gc_registry.gc) > 0)
+            hash_delete(chan_gc_registry.gc, simd_itoa(id, error_message));
+        atomic_unlock(&chan_gc_lock);
     }
 }
 
-static RAII_INLINE void add_msg(msg_queue_t *a, channel_co_t *alt) {
-    if (a->n == a->m) {
-        a->m += 16;
-        a->a = RAII_REALLOC(a->a, a->m * sizeof(a->a[ 0 ]));
+/* Add to ring, `false` if full. */
+static bool chan_push(channel_t c, const void *v) {
+    size_t pos = atomic_load_explicit(&c->head, memory_order_relaxed), seq;
+    chan_slot_t *slot;
+    intptr_t diff;
+
+    for (;;) {
+        slot = chan_slot(c, pos);
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos * 2);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&c->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+        }
     }
-    a->a[ a->n++ ] = alt;
+
+    memcpy(chan_slot_data(slot), v, c->elem_size);
+    atomic_store_explicit(&slot->seq, pos * 2 + 1, memory_order_release);
+    return true;
 }
 
-static RAII_INLINE void del_msg(msg_queue_t *a, u32 i) {
-    --a->n;
-    a->a[ i ] = a->a[ a->n ];
+/* Take from ring, `false` if empty. */
+static bool chan_pop(channel_t c, void *v) {
+    size_t pos = atomic_load_explicit(&c->tail, memory_order_relaxed), seq;
+    chan_slot_t *slot;
+    intptr_t diff;
+
+    for (;;) {
+        slot = chan_slot(c, pos);
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos * 2 + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&c->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&c->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(v, chan_slot_data(slot), c->elem_size);
+    atomic_store_explicit(&slot->seq, (pos + c->bufsize) * 2, memory_order_release);
+    return true;
 }
 
-/*
- * doesn't really work for things other than CHANNEL_SEND and CHANNEL_RECV
- * but is only used as arg to channel_msg, which can handle it
- */
-#define other_op(op) (CHANNEL_SEND + CHANNEL_RECV - (op))
-
-static msg_queue_t *channel_msg(channel_t c, unsigned int op) {
-    switch (op) {
-        case CHANNEL_SEND:
-            return &c->a_send;
-        case CHANNEL_RECV:
-            return &c->a_recv;
-        default:
-            return NULL;
+static RAII_INLINE void add_msg(msg_queue_t *a, channel_co_t *alt) {
+    alt->next = nullptr;
+    if (is_empty(a->tail))
+        a->head = alt;
+    else
+        a->tail->next = alt;
+
+    a->tail = alt;
+}
+
+static RAII_INLINE channel_co_t *del_msg(msg_queue_t *a) {
+    channel_co_t *alt = a->head;
+    if (!is_empty(alt) && is_empty(a->head = alt->next))
+        a->tail = nullptr;
+
+    return alt;
+}
+
+/* Take next waiter to resume from `a`, skipping `chan_select` ones already
+claimed through another channel, `lock` held. */
+static channel_co_t *chan_waiter(msg_queue_t *a, atomic_size_t *waiting) {
+    channel_co_t *alt;
+    size_t pending;
+
+    while (!is_empty(alt = del_msg(a))) {
+        atomic_fetch_sub(waiting, 1);
+        pending = 0;
+        if (is_empty(alt->sel) || atomic_compare_exchange_strong(alt->sel, &pending, alt->index + 1))
+            break;
     }
+
+    return alt;
 }
 
-static int channel_coro_can_exec(channel_co_t *a) {
-    msg_queue_t *ar;
-    channel_t c;
+/* Remove `alt` from `a` if still there, `lock` held. */
+static void chan_unlink(msg_queue_t *a, channel_co_t *alt, atomic_size_t *waiting) {
+    channel_co_t *prev = nullptr, *it;
 
-    if (a->op == CHANNEL_OP)
-        return 0;
-    c = a->c;
-    if (c->bufsize == 0) {
-        ar = channel_msg(c, other_op(a->op));
-        return ar && ar->n;
-    } else {
-        switch (a->op) {
-            case CHANNEL_SEND:
-                return c->nbuf < c->bufsize;
-            case CHANNEL_RECV:
-                return c->nbuf > 0;
-            default:
-                return 0;
+    for (it = a->head; !is_empty(it); prev = it, it = it->next) {
+        if (it == alt) {
+            if (is_empty(prev))
+                a->head = it->next;
+            else
+                prev->next = it->next;
+
+            if (a->tail == it)
+                a->tail = prev;
+
+            atomic_fetch_sub(waiting, 1);
+            break;
         }
     }
 }
 
-static RAII_INLINE void channel_coro_enqueue(channel_co_t *a) {
-    msg_queue_t *ar;
+/* Resume up to `n` coroutines parked in `a`, if any counted in `waiting`. */
+static void chan_wake_n(channel_t c, msg_queue_t *a, atomic_size_t *waiting, size_t n) {
+    channel_co_t *alt, *woken = nullptr, *next;
 
-    ar = channel_msg(a->c, a->op);
-    add_msg(ar, a);
-}
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiting, memory_order_relaxed) == 0)
+        return;
 
-static void channel_coro_dequeue(channel_co_t *a) {
-    u32 i;
-    msg_queue_t *ar;
+    atomic_lock(&c->lock);
+    while (n-- > 0 && !is_empty(alt = chan_waiter(a, waiting))) {
+        alt->next = woken;
+        woken = alt;
+    }
+    atomic_unlock(&c->lock);
 
-    ar = channel_msg(a->c, a->op);
-    if (is_empty(ar)) {
-        snprintf(error_message, SCRAPE_SIZE, "bad use of channel_coro_dequeue op=%d\n", a->op);
-        raii_panic(error_message);
+    for (alt = woken; !is_empty(alt); alt = next) {
+        next = alt->next;
+        coro_wake(alt->co);
     }
+}
 
-    for (i = 0; i < ar->n; i++)
-        if (ar->a[ i ] == a) {
-            del_msg(ar, i);
-            return;
-        }
-    raii_panic("cannot find self in channel_coro_dequeue");
+static RAII_INLINE void chan_wake(channel_t c, msg_queue_t *a, atomic_size_t *waiting) {
+    chan_wake_n(c, a, waiting, 1);
 }
 
-static RAII_INLINE void channel_coro_all_dequeue(channel_co_t *a) {
-    int i;
+/* Park current coroutine in `a`, `c->lock` held, released before switching out. */
+static void chan_park(channel_t c, msg_queue_t *a, channel_co_t *alt) {
+    routine_t *t = coro_park_current();
 
-    for (i = 0; a[ i ].op != CHANNEL_END && a[ i ].op != CHANNEL_BLK; i++)
-        if (a[ i ].op != CHANNEL_OP)
-            channel_coro_dequeue(&a[ i ]);
+    alt->co = t;
+    alt->sel = nullptr;
+    add_msg(a, alt);
+    c->select_ready = true;
+    atomic_unlock(&c->lock);
+    coro_trace(CORO_TRACE_CHAN_BLOCK, a == &c->a_send ? CHAN_SEND : CHAN_RECV);
+    coro_suspend();
+    coro_unref(t);
 }
 
-static RAII_INLINE void amove(void_t dst, void_t src, unsigned int n) {
-    if (dst) {
-        if (is_empty(src))
-            memset(dst, 0, n);
+/* Unbuffered channel, exchange `v` with an parked peer taken from it's queue, `lock` held.
+Peer is returned for waking after unlocking, `nullptr` if none. */
+static channel_co_t *chan_peer(channel_t c, void *v, bool sending) {
+    channel_co_t *other = sending ? chan_waiter(&c->a_recv, &c->recv_waiting)
+                                  : chan_waiter(&c->a_send, &c->send_waiting);
+
+    if (!is_empty(other)) {
+        if (sending)
+            memcpy(other->v, v, c->elem_size);
         else
-            memmove(dst, src, n);
+            memcpy(v, other->v, c->elem_size);
+
+        other->done = true;
     }
+
+    return other;
 }
 
-/*
- * Actually move the data around.  There are up to three
- * players: the sender, the receiver, and the channel itself.
- * If the channel is unbuffered or the buffer is empty,
- * data goes from sender to receiver.  If the channel is full,
- * the receiver removes some from the channel and the sender
- * gets to put some in.
- */
-static void channel_coro_copy(channel_co_t *s, channel_co_t *r) {
-    channel_co_t *t;
-    channel_t c;
-    unsigned char *cp;
+/* Unbuffered channel, exchange `v` with an already parked peer, `false` if none. */
+static bool chan_handoff_try(channel_t c, void *v, bool sending) {
+    channel_co_t *other;
 
-    /*
-     * Work out who is sender and who is receiver
-     */
-    if (is_empty(s) && is_empty(r))
-        return;
-    RAII_ASSERT(!is_empty(s));
-    c = s->c;
-    if (s->op == CHANNEL_RECV) {
-        t = s;
-        s = r;
-        r = t;
-    }
-    RAII_ASSERT(is_empty(s) || s->op == CHANNEL_SEND);
-    RAII_ASSERT(is_empty(r) || r->op == CHANNEL_RECV);
-
-    /*
-     * channel_t is empty (or unbuffered) - copy directly.
-     */
-    if (s && r && c->nbuf == 0) {
-        amove(r->v, s->v, c->elem_size);
+    atomic_lock(&c->lock);
+    other = chan_peer(c, v, sending);
+    atomic_unlock(&c->lock);
+    if (is_empty(other))
+        return false;
+
+    coro_wake(other->co);
+    return true;
+}
+
+/* Unbuffered channel, hand `v` to an parked receiver, or park until one takes it. */
+static void chan_handoff(channel_t c, void *v, bool sending) {
+    channel_co_t *other, self;
+
+    atomic_lock(&c->lock);
+    if (!is_empty(other = chan_peer(c, v, sending))) {
+        atomic_unlock(&c->lock);
+        coro_wake(other->co);
         return;
     }
 
-    /*
-     * Otherwise it's always okay to receive and then send.
-     */
-    if (r) {
-        cp = c->buf + c->off * c->elem_size;
-        amove(r->v, cp, c->elem_size);
-        --c->nbuf;
-        if (++c->off == c->bufsize)
-            c->off = 0;
-    }
-    if (s) {
-        cp = c->buf + (c->off + c->nbuf) % c->bufsize * c->elem_size;
-        amove(cp, s->v, c->elem_size);
-        ++c->nbuf;
+    self.v = v;
+    self.done = false;
+    atomic_fetch_add(sending ? &c->send_waiting : &c->recv_waiting, 1);
+    chan_park(c, sending ? &c->a_send : &c->a_recv, &self);
+    if (!self.done)
+        raii_panic("channel coroutine resumed before handoff");
+}
+
+/* Buffered channel, park until `v` fits, `lock` not held. */
+static void chan_send_park(channel_t c, const void *v) {
+    channel_co_t self;
+
+    for (;;) {
+        if (chan_push(c, v))
+            return;
+
+        /* full, park until an receiver makes room */
+        atomic_lock(&c->lock);
+        atomic_fetch_add(&c->send_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (chan_push(c, v)) {
+            atomic_fetch_sub(&c->send_waiting, 1);
+            atomic_unlock(&c->lock);
+            return;
+        }
+
+        self.v = (void *)v;
+        chan_park(c, &c->a_send, &self);
     }
 }
 
-static void channel_coro_exec(channel_co_t *a) {
-    int i;
-    msg_queue_t *ar;
-    channel_co_t *other;
-    channel_t c;
+/* Buffered channel, park until there's an value for `v`, `lock` not held. */
+static void chan_recv_park(channel_t c, void *v) {
+    channel_co_t self;
+
+    for (;;) {
+        if (chan_pop(c, v))
+            return;
 
-    c = a->c;
-    ar = channel_msg(c, other_op(a->op));
-    if (ar && ar->n) {
-        i = rand() % ar->n;
-        other = ar->a[ i ];
-        channel_coro_copy(a, other);
-        channel_coro_all_dequeue(other->x_msg);
-        other->x_msg[ 0 ].x_msg = other;
-        coro_enqueue(other->co);
-    } else {
-        channel_coro_copy(a, NULL);
+        /* empty, park until an sender fills */
+        atomic_lock(&c->lock);
+        atomic_fetch_add(&c->recv_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (chan_pop(c, v)) {
+            atomic_fetch_sub(&c->recv_waiting, 1);
+            atomic_unlock(&c->lock);
+            return;
+        }
+
+        self.v = v;
+        chan_park(c, &c->a_recv, &self);
     }
 }
 
-static int channel_proc(channel_co_t *a) {
-    int i, j, n_can, n, can_block;
-    channel_t c;
-    routine_t *t;
+size_t chan_send_n(channel_t c, const void *elems, size_t n) {
+    const char *p = (const char *)elems;
+    size_t i = 0, pushed;
 
     coro_stealer();
     coro_stack_check(512);
-    for (i = 0; a[ i ].op != CHANNEL_END && a[ i ].op != CHANNEL_BLK; i++);
-    n = i;
-    can_block = a[ i ].op == CHANNEL_END;
-
-    t = coro_ref_current();
-    for (i = 0; i < n; i++) {
-        a[ i ].co = t;
-        a[ i ].x_msg = a;
-    }
+    if (c->bufsize == 0) {
+        for (; i < n; i++)
+            chan_handoff(c, (void *)(p + i * c->elem_size), true);
 
-    RAII_LOG("processed ");
+        return n;
+    }
 
-    n_can = 0;
-    for (i = 0; i < n; i++) {
-        c = a[ i ].c;
+    while (i < n) {
+        /* fill what fits, then wake an receiver for each */
+        for (pushed = 0; i < n && chan_push(c, p + i * c->elem_size); i++)
+            pushed++;
 
-        RAII_INFO(" %c:", "esrnb"[ a[ i ].op ]);
-#ifdef USE_DEBUG
-        if (c->name)
-            printf("%s", c->name);
-        else
-            printf("%p", c);
-#endif
-        if (channel_coro_can_exec(&a[ i ])) {
-            RAII_LOG("*");
-            n_can++;
+        if (pushed == 0) {
+            chan_send_park(c, p + i * c->elem_size);
+            pushed = 1;
+            i++;
         }
-    }
 
-    if (n_can) {
-        j = rand() % n_can;
-        for (i = 0; i < n; i++) {
-            if (channel_coro_can_exec(&a[ i ])) {
-                if (j-- == 0) {
-                    c = a[ i ].c;
-                    RAII_INFO(" => %c:", "esrnb"[ a[ i ].op ]);
-#ifdef USE_DEBUG
-                    if (c->name)
-                        printf("%s", c->name);
-                    else
-                        printf("%p", c);
-#endif
-                    RAII_LOG(" ");
-
-                    channel_coro_exec(&a[ i ]);
-                    return i;
-                }
-            }
-        }
+        chan_wake_n(c, &c->a_recv, &c->recv_waiting, pushed);
     }
 
-    RAII_LOG(" ");
-    if (!can_block)
-        return -1;
+    return n;
+}
+
+size_t chan_recv_n(channel_t c, void *elems, size_t max) {
+    char *p = (char *)elems;
+    size_t got = 1;
+
+    if (max == 0)
+        return 0;
+
+    coro_stealer();
+    coro_stack_check(512);
+    if (c->bufsize == 0) {
+        chan_handoff(c, p, false);
+        /* senders already parked, without waiting for more */
+        while (got < max && chan_handoff_try(c, p + got * c->elem_size, false))
+            got++;
 
-    for (i = 0; i < n; i++) {
-        if (a[ i ].op != CHANNEL_OP)
-            channel_coro_enqueue(&a[ i ]);
+        return got;
     }
 
-    a[0].c->select_ready = true;
-    coro_suspend();
-    coro_unref(t);
+    chan_recv_park(c, p);
+    while (got < max && chan_pop(c, p + got * c->elem_size))
+        got++;
 
-    /*
-     * the guy who ran the op took care of dequeueing us
-     * and then set a[0].x_msg to the one that was executed.
-     */
-    return (int)(a[ 0 ].x_msg - a);
+    chan_wake_n(c, &c->a_send, &c->send_waiting, got);
+    return got;
 }
 
 void channel_print(channel_t c) {
-    u32 i;
+    size_t head = atomic_load(&c->head), tail = atomic_load(&c->tail), i;
     printf("--- start print channel ---\n");
-    printf("buf content: [nbuf: %d, off: %d] \n", c->nbuf, c->off);
+    printf("buf content: [head: %zu, tail: %zu, size: %d, elem_size: %d] \n",
+           head, tail, c->bufsize, c->elem_size);
     printf("buf: ");
-    for (i = 0; i < c->bufsize; i++) {
-        unsigned long *p = (unsigned long *)c->buf + i;
-        printf("%ld ", *p);
-    }
-    printf("\n");
-    printf("msg queue: ");
-    channel_co_t *a = *(c->a_send.a);
-    for (i = 0; i < c->a_send.n; i++) {
-        unsigned long *p = (unsigned long *)a->v;
-        printf("%ld ", *p);
-        a = a->x_msg[ 0 ].x_msg;
-    }
+    for (i = tail; i < head && c->boxed; i++)
+        printf("%ld ", ((raii_values_t *)chan_slot_data(chan_slot(c, i)))->value.s_long);
     printf("\n");
+    printf("waiting: [send: %zu, recv: %zu]\n",
+           atomic_load(&c->send_waiting), atomic_load(&c->recv_waiting));
     printf("--- end print channel ---\n");
 }
 
-static RAII_INLINE int _channel_op(channel_t c, unsigned int op, void_t p, unsigned int can_block) {
-    channel_co_t a[ 2 ];
-
-    a[ 0 ].c = c;
-    a[ 0 ].op = op;
-    a[ 0 ].v = p;
-    a[ 1 ].op = can_block ? CHANNEL_END : CHANNEL_BLK;
-    if (channel_proc(a) < 0)
-        return -1;
-    return 1;
-}
-
 RAII_INLINE bool chan_ready(channel_t c) {
     return c->select_ready;
 }
@@ -396,26 +490,215 @@ RAII_INLINE void chan_ready_reset(channel_t c) {
     c->select_ready = false;
 }
 
-RAII_INLINE int chan_send(channel_t c, void_t v) {
-    return _channel_op(c, CHANNEL_SEND, &v, 1);
+int chan_send(channel_t c, void_t v) {
+    raii_values_t value;
+
+    if (!c->boxed) {
+        /* `channel_of`, `v` points to the element */
+        chan_send_n(c, v, 1);
+        return 1;
+    }
+
+    memset(&value, 0, sizeof(value));
+    value.value.object = v;
+    chan_send_n(c, &value, 1);
+    return 1;
+}
+
+template_t chan_recv(channel_t c) {
+    raii_values_t value;
+
+    if (!c->boxed) {
+        if (c->elem_size > sizeof(template_t))
+            raii_panic("channel element larger than `template_t`, use `chan_recv_n`");
+
+        memset(&value, 0, sizeof(value));
+        chan_recv_n(c, value.value.buffer, 1);
+        return value.value;
+    }
+
+    chan_recv_n(c, &value, 1);
+    return value.value;
+}
+
+/* Lock, or unlock, every distinct channel in `ops`, in address order. */
+static void chan_lock_all(chan_op_t ops[], int n, bool locking) {
+    uintptr_t last = 0, next;
+    channel_t c = nullptr;
+    int i;
+
+    for (;;) {
+        next = UINTPTR_MAX;
+        for (i = 0; i < n; i++) {
+            if ((uintptr_t)ops[i].ch > last && (uintptr_t)ops[i].ch < next) {
+                next = (uintptr_t)ops[i].ch;
+                c = ops[i].ch;
+            }
+        }
+
+        if (next == UINTPTR_MAX)
+            break;
+
+        if (locking) {
+            atomic_lock(&c->lock);
+        } else {
+            atomic_unlock(&c->lock);
+        }
+
+        last = next;
+    }
+}
+
+static RAII_INLINE atomic_size_t *chan_waiting(chan_op_t *op) {
+    return op->op == CHAN_SEND ? &op->ch->send_waiting : &op->ch->recv_waiting;
+}
+
+static RAII_INLINE msg_queue_t *chan_queue(chan_op_t *op) {
+    return op->op == CHAN_SEND ? &op->ch->a_send : &op->ch->a_recv;
+}
+
+/* Where `op` element is, an `channel_of` op points to it, others wrap `value` in `v`. */
+static RAII_INLINE void *chan_op_data(chan_op_t *op, raii_values_t *v) {
+    if (!op->ch->boxed)
+        return op->value.object;
+
+    memset(v, 0, sizeof(raii_values_t));
+    v->value = op->value;
+    return v;
+}
+
+/* Try `op` without blocking, all channels locked, unbuffered peer taken goes in `peer`. */
+static bool chan_try(chan_op_t *op, void *v, channel_co_t **peer) {
+    channel_t c = op->ch;
+
+    if (c->bufsize > 0)
+        return op->op == CHAN_SEND ? chan_push(c, v) : chan_pop(c, v);
+
+    return !is_empty(*peer = chan_peer(c, v, op->op == CHAN_SEND));
 }
 
-RAII_INLINE template_t chan_recv(channel_t c) {
-    _channel_op(c, CHANNEL_RECV, c->data, 1);
-    return c->data->value;
+int chan_select(chan_op_t ops[], int n, int timeout_ms) {
+    channel_co_t *alts = nullptr, *peer = nullptr;
+    raii_values_t *vals = nullptr, v;
+    atomic_size_t claim;
+    channel_t c;
+    routine_t *t;
+    uint64_t deadline = 0, now;
+    size_t won;
+    int i, k, first = 0, chosen = -1;
+    u32 remaining = 0;
+
+    coro_stealer();
+    coro_stack_check(512);
+    if (timeout_ms > 0)
+        deadline = get_timer() + (uint64_t)timeout_ms * 1000000;
+
+    for (;;) {
+        chan_lock_all(ops, n, true);
+        /* count as waiting before trying, so ring operations that follow see it */
+        for (i = 0; i < n; i++)
+            atomic_fetch_add(chan_waiting(&ops[i]), 1);
+
+        atomic_thread_fence(memory_order_seq_cst);
+        for (k = 0; k < n && chosen < 0; k++) {
+            i = (first + k) % n;
+            if (chan_try(&ops[i], chan_op_data(&ops[i], &v), &peer)) {
+                chosen = i;
+                if (ops[i].op == CHAN_RECV && ops[i].ch->boxed)
+                    ops[i].value = v.value;
+            }
+        }
+
+        if (timeout_ms > 0 && chosen < 0) {
+            now = get_timer();
+            remaining = now < deadline ? (u32)((deadline - now + 999999) / 1000000) : 0;
+        }
+
+        if (chosen >= 0 || timeout_ms == 0 || (timeout_ms > 0 && remaining == 0)) {
+            for (i = 0; i < n; i++)
+                atomic_fetch_sub(chan_waiting(&ops[i]), 1);
+
+            chan_lock_all(ops, n, false);
+            break;
+        }
+
+        if (is_empty(alts)) {
+            alts = try_calloc(n, sizeof(channel_co_t) + sizeof(raii_values_t));
+            vals = (raii_values_t *)(alts + n);
+        }
+
+        t = coro_park_current();
+        atomic_init(&claim, 0);
+        for (i = 0; i < n; i++) {
+            alts[i].co = t;
+            alts[i].v = chan_op_data(&ops[i], &vals[i]);
+            alts[i].done = false;
+            alts[i].sel = &claim;
+            alts[i].index = i;
+            add_msg(chan_queue(&ops[i]), &alts[i]);
+            ops[i].ch->select_ready = true;
+        }
+
+        chan_lock_all(ops, n, false);
+        /* `op` of `0`, blocked in select */
+        coro_trace(CORO_TRACE_CHAN_BLOCK, 0);
+        if (timeout_ms > 0)
+            coro_park_for(&claim, remaining);
+        else
+            coro_suspend();
+
+        coro_unref(t);
+        chan_lock_all(ops, n, true);
+        for (i = 0; i < n; i++)
+            chan_unlink(chan_queue(&ops[i]), &alts[i], chan_waiting(&ops[i]));
+        chan_lock_all(ops, n, false);
+
+        won = atomic_load(&claim);
+        if (won == CORO_PARK_EXPIRED)
+            break;
+
+        i = (int)won - 1;
+        if (alts[i].done) {
+            /* unbuffered, value already handed over */
+            if (ops[i].op == CHAN_RECV && ops[i].ch->boxed)
+                ops[i].value = vals[i].value;
+            chosen = i;
+            break;
+        }
+
+        /* buffered, woken for room or an value, retry that op first */
+        first = i;
+    }
+
+    if (!is_empty(alts))
+        free(alts);
+
+    if (!is_empty(peer)) {
+        coro_wake(peer->co);
+    } else if (chosen >= 0 && ops[chosen].ch->bufsize > 0) {
+        /* ring changed, resume an waiter on the other side */
+        c = ops[chosen].ch;
+        if (ops[chosen].op == CHAN_SEND)
+            chan_wake(c, &c->a_recv, &c->recv_waiting);
+        else
+            chan_wake(c, &c->a_send, &c->send_waiting);
+    }
+
+    return chosen;
 }
 
 reflect_func(_channel_t,
              (BOOL, bool, select_ready),
+             (BOOL, bool, boxed),
              (UINT, u32, bufsize),
              (UINT, u32, elem_size),
-             (UINT, u32, nbuf),
-             (UINT, u32, off),
+             (UINT, u32, slot_size),
              (UINT, u32, id),
              (STRING, char *, name),
-             (UCHAR_P, unsigned char *, buf),
+             (PTR, char *, buf),
+             (MAXSIZE, atomic_size_t, head),
+             (MAXSIZE, atomic_size_t, tail),
              (STRUCT, msg_queue_t, a_send),
-             (STRUCT, msg_queue_t, a_recv),
-             (STRUCT, raii_values_t *, data)
+             (STRUCT, msg_queue_t, a_recv)
 )
-reflect_alias(_channel_t)
\ No newline at end of file
+reflect_alias(_channel_t)
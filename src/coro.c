@@ -1,8 +1,39 @@
+#ifndef _WIN32
+#   define _GNU_SOURCE
+#endif
+
 #include "channel.h"
 
+#if defined(__linux__)
+#   include <sched.h>
+#   include <sys/epoll.h>
+#   include <sys/eventfd.h>
+#   define CORO_REACTOR 1
+#   if !defined(CORO_NO_URING)
+#       include <linux/io_uring.h>
+#       include <sys/syscall.h>
+#       include <sys/sysmacros.h>
+#       include <linux/stat.h>
+#       ifndef AT_EMPTY_PATH
+#           define AT_EMPTY_PATH 0x1000
+#       endif
+#       define CORO_URING 1
+#   endif
+#elif !defined(_WIN32)
+#   include <poll.h>
+#endif
+
 static volatile bool thrd_queue_set = false;
 static volatile bool coro_interrupt_set = false;
 static volatile bool coro_threading_enabled = true;
+/* Set by `coro_workers/coro_affinity`, or environment, applied when scheduler starts. */
+static u32 coro_workers_requested = 0;
+static bool coro_affinity_requested = false;
+static coro_affinity_t coro_affinity_policy = CORO_AFFINITY_NONE;
+static char coro_affinity_list[256] = {0};
+/* Allowed cpus in placement order, `coro_cpu_count` of them. */
+static int *coro_cpus = nullptr;
+static u32 coro_cpu_count = 0;
 static volatile sig_atomic_t can_cleanup = true;
 static call_interrupter_t coro_interrupt_loop = nullptr;
 static call_t coro_interrupt_init = nullptr;
@@ -10,6 +41,125 @@ static func_t coro_interrupt_shutdown = nullptr;
 static int coro_argc;
 static char **coro_argv;
 static void(fastcall *coro_swap)(routine_t *, routine_t *) = 0;
+/* coroutine stack pool counters, collected from all threads */
+static atomic_size_t stack_pool_hits = 0;
+static atomic_size_t stack_pool_misses = 0;
+static atomic_size_t stack_pool_trimmed = 0;
+#if defined(USE_MMAP_STACK)
+static size_t coro_page_size = 0;
+#endif
+
+/* Eventcount to park idle scheduler threads, instead of spinning. */
+static struct {
+    atomic_size_t epoch;
+    atomic_size_t waiters;
+    /* `eventfd` in every worker's reactor, to wake threads parked in `epoll_wait` */
+    int io_wake;
+    mtx_t lock;
+    cnd_t wake;
+} coro_parking;
+
+/* Thread writing `coro_stats_print` every `interval` milliseconds. */
+static struct {
+    bool running;
+    u32 interval;
+    FILE *out;
+    thrd_t thread;
+    mtx_t lock;
+    cnd_t wake;
+} coro_stats_dumper;
+
+/* Run slices of coroutines sharing an name, on one thread, written only by that thread. */
+typedef struct {
+    /* hash of `name`, or `func` if unnamed, `0` while slot unused */
+    atomic_size_t key;
+    void_t func;
+    char name[64];
+    atomic_size_t slices;
+    atomic_size_t total_ns;
+    atomic_size_t max_ns;
+    /* slices longer than threshold, and time spent in them */
+    atomic_size_t slow;
+    atomic_size_t slow_ns;
+    atomic_size_t buckets[CORO_PROFILE_BUCKETS];
+} coro_profile_entry_t;
+
+typedef struct {
+    /* `coro_profiler.epoch` counted in, table from an earlier start if behind */
+    atomic_size_t epoch;
+    coro_profile_entry_t other;
+    coro_profile_entry_t entries[CORO_PROFILE_SLOTS];
+} coro_profile_t;
+
+/* Profiler state, tables indexed by thread id, allocated on first `coro_profile_start`.
+Tables are never cleared in place by `coro_profile_start`, it only bumps `epoch`,
+each thread resets it's own table on it's next slice. */
+static struct {
+    atomic_flag enabled;
+    atomic_size_t epoch;
+    size_t threshold_ns;
+    u32 count;
+    coro_profile_t **tables;
+} coro_profiler;
+
+typedef struct {
+    size_t ts;
+    /* run slice length, `CORO_TRACE_SWITCH` only */
+    size_t dur;
+    u32 cid;
+    u32 arg;
+    coro_trace_kind kind;
+} coro_trace_event_t;
+
+/* Events of one thread, written only by that thread, `head` counts all ever written. */
+typedef struct coro_trace_ring_s coro_trace_ring_t;
+struct coro_trace_ring_s {
+    atomic_size_t head;
+    size_t mask;
+    /* events allocated, `mask` can be set smaller */
+    size_t size;
+    /* smaller ring replaced by `coro_trace_start`, an worker may still write it */
+    coro_trace_ring_t *retired;
+    coro_trace_event_t events[1];
+};
+
+/* Tracer state, rings indexed by thread id, allocated by `coro_trace_start`. */
+static struct {
+    atomic_flag enabled;
+    size_t started;
+    u32 count;
+    size_t capacity;
+    coro_trace_ring_t **rings;
+} coro_tracer;
+
+/* Record event, only if tracing. */
+#define coro_traced(kind, cid, arg) do {                                            \
+    if (atomic_flag_load_explicit(&coro_tracer.enabled, memory_order_relaxed))    \
+        coro_trace_put((kind), (cid), (arg), get_timer(), 0);                     \
+} while (0)
+
+static void coro_trace_put(coro_trace_kind kind, u32 cid, u32 arg, size_t ts, size_t dur);
+static void coro_trace_free(void);
+static void coro_profile_slice(routine_t *t, size_t ns);
+static void coro_profile_free(void);
+static void coro_stats_stop(void);
+static void coro_unpark(void);
+static void coro_park(bool (*ready)(void), size_t timeout);
+static bool coro_park_local(void);
+static void coro_reactor_free(void);
+static void coro_reactor_wake(void);
+static void coro_timeout_cancel(routine_t *t);
+static void coro_io_cancel(routine_t *t);
+static void coro_fs_reap(void);
+static void coro_fs_shutdown(void);
+/* In `preempt.c`, start new time slice for `co` on the calling worker, `nullptr` when back in scheduler. */
+void preempt_slice(routine_t *co);
+/* Release the calling worker time slice timer. */
+void preempt_detach(void);
+#if defined(CORO_URING)
+static int coro_ring_flush(void);
+static void coro_ring_free(void);
+#endif
 
 coro_sys_func coro_main_func = nullptr;
 bool coro_sys_set = false;
@@ -81,6 +231,8 @@ struct coro_s {
 #endif
 };
 
+typedef struct wait_state_s wait_state_t;
+
 /* Coroutine extended context. */
 struct routine_s {
 #if defined(USE_UCONTEXT)
@@ -97,6 +249,8 @@ struct routine_s {
     size_t magic_number;
     /* Coroutine stack size. */
     size_t stack_size;
+    /* Stack pool size class, `RAII_ERR` if not recyclable. */
+    i32 pool_class;
     bool taken;
     bool ready;
     bool system;
@@ -113,8 +267,27 @@ struct routine_s {
     bool is_referenced;
     bool flagged;
     bool is_generator;
+    /* parked in thread's reactor, waiting on an fd */
+    bool io_active;
+    /* resumed by `coro_enqueue`, not by fd readiness */
+    bool io_cancelled;
+    /* fd of reactor wait, `RAII_ERR` for file requests, which can't be cancelled */
+    int io_wait_fd;
+    /* set by other threads, owning reactor drops the wait */
+    atomic_flag io_cancel;
+    /* parked on an wait queue, only `coro_wake` resumes it */
+    bool parked;
+    /* enqueued while running, scheduler pushes it on `deque` after switching out */
+    bool requeue;
+    /* `waitgroup` member handed to an thread's `deque`, only once, by either
+    `coro_post_available`, `coro_group_post` or `coro_transfer` */
+    bool posted;
+    /* shared with wakers while in `coro_park_for`, first to swap it from `0` resumes */
+    atomic_size_t *park_claim;
     signed int event_err_code;
     size_t alarm_time;
+    /* position in thread's sleep heap, plus one, `0` when not sleeping */
+    u32 sleep_index;
     size_t cycles;
     u32 interrupt_timers;
     /* unique result id */
@@ -127,6 +300,9 @@ struct routine_s {
     u32 tid;
     coro_states status;
     run_mode run_code;
+    /* run queue class, and `get_timer()` due time when created by `go_deadline` */
+    coro_priority_t priority;
+    size_t deadline;
     void_t user_data;
     void_t args;
     /* Coroutine result of function return/exit. */
@@ -139,9 +315,19 @@ struct routine_s {
     generator_t yield;
     waitgroup_t wait_group;
     waitgroup_t event_group;
+    /* completion state of `waitgroup` this coroutine is member of */
+    wait_state_t *group;
+    /* completion states of `waitgroup`s created by this coroutine */
+    wait_state_t *groups;
+    /* next finished member in `group` completion list */
+    routine_t *group_next;
+    /* next in owning thread's `inbox`, woken by `coro_wake` from another thread */
+    routine_t *wake_next;
     routine_t *context;
     char name[64];
     char scrape[SCRAPE_SIZE];
+    /* `go` arguments array, header then up to `CORO_INLINE_ARGS` values */
+    template args_inline[ARRAY_INLINE_SLOTS(CORO_INLINE_ARGS)];
 };
 
 struct generator_s {
@@ -152,13 +338,74 @@ struct generator_s {
     routine_t *context;
 };
 
+/* Run queue levels, `go_deadline` coroutines first, then each `coro_priority_t` class. */
+#define CORO_RUN_LEVELS 4
+#define CORO_RUN_LEVEL(t) ((t)->deadline ? 0 : (int)(t)->priority - CORO_PRIORITY_HIGH + 1)
+
+/* scheduler queue level, FIFO, or earliest deadline first for level `0` */
+typedef struct {
+    routine_t *head;
+    routine_t *tail;
+    /* times an higher level ran, while this one waited */
+    u32 passed;
+} run_level_t;
+
 /* scheduler queue struct */
 typedef struct scheduler_s {
     raii_type type;
-    routine_t *head;
-    routine_t *tail;
+    size_t count;
+    run_level_t level[CORO_RUN_LEVELS];
 } scheduler_t;
 
+/* Per worker scheduler counters, written only by owning thread, read by any. */
+typedef struct {
+    atomic_size_t switches;
+    atomic_size_t spawned;
+    atomic_size_t completed;
+    /* run queue depth, and coroutines sleeping, as last seen by scheduler */
+    atomic_size_t queued;
+    atomic_size_t sleeping;
+    /* time spent parked, and when current park started, `0` if running */
+    atomic_size_t idle_ns;
+    atomic_size_t parked;
+    /* when worker started counting, `get_timer()` */
+    atomic_size_t started;
+} coro_counters_t;
+
+/* Coroutines parked on an fd, per worker. */
+typedef struct {
+    routine_t *reader;
+    routine_t *writer;
+} coro_io_t;
+
+typedef struct coro_fs_s coro_fs_t;
+make_atomic(coro_fs_t *, atomic_fs_t)
+
+#if defined(CORO_URING)
+/* Per worker `io_uring`, rings mapped from kernel. */
+typedef struct {
+    int fd;
+    u32 entries;
+    /* SQEs filled in, not yet submitted to kernel */
+    u32 queued;
+    /* submitted, not yet completed */
+    u32 inflight;
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32 *sq_mask;
+    u32 *sq_array;
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32 *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void_t sq_ptr;
+    void_t cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+} coro_ring_t;
+#endif
+
 typedef struct {
     bool stopped;
     bool started;
@@ -180,6 +427,22 @@ typedef struct {
     /* random seed (for work stealing) */
     u32 seed;
     u32 stolen_count;
+    /* consecutive failed steal rounds, resets when work found */
+    u32 steal_backoff;
+    /* scheduler counters, in thread's `deque`, bound on first use */
+    coro_counters_t *counters;
+    /* stack pool counters, not yet collected into global counters */
+    u32 pool_hits;
+    u32 pool_misses;
+    u32 pool_trimmed;
+    /* number of recycled stacks held per size class */
+    u32 pool_count[CORO_POOL_CLASSES];
+    /* recycled coroutine stacks, linked by `next`, per size class */
+    routine_t *stack_pool[CORO_POOL_CLASSES];
+#if defined(USE_MMAP_STACK)
+    /* alternate signal stack, to handle guard page hits */
+    void_t signal_stack;
+#endif
     i32 interrupter_active;
     /* record thread integration code */
     i32 interrupt_code;
@@ -206,10 +469,33 @@ typedef struct {
     /* Store/hold the registers of the default coroutine thread state,
     allows the ability to switch from any function, non coroutine context. */
     routine_t active_buffer[1];
-    /* record which coroutine sleeping in scheduler */
-    scheduler_t sleep_queue[1];
-    /* coroutines's FIFO scheduler queue */
+    /* number of coroutines in, and capacity of `sleep_heap` */
+    u32 sleep_size;
+    u32 sleep_capacity;
+    /* record which coroutine sleeping in scheduler, 4-ary min heap on `alarm_time` */
+    routine_t **sleep_heap;
+    /* coroutines's FIFO scheduler queue, one per priority level */
     scheduler_t run_queue[1];
+    /* class, and deadline, of next coroutine `go_priority/go_deadline` creates */
+    coro_priority_t spawn_priority;
+    size_t spawn_deadline;
+#if defined(CORO_REACTOR)
+    /* `epoll` instance of reactor, `-1` until first I/O wait */
+    int io_fd;
+    /* number of coroutines parked waiting on an fd */
+    u32 io_waiting;
+    /* coroutines dispatched, since last readiness poll */
+    u32 io_ticks;
+    /* capacity of `io_table`, indexed by fd */
+    u32 io_capacity;
+    coro_io_t *io_table;
+    struct epoll_event io_events[CORO_REACTOR_EVENTS];
+    /* file requests completed by offload threads, pushed from any thread */
+    atomic_fs_t fs_done;
+#endif
+#if defined(CORO_URING)
+    coro_ring_t ring[1];
+#endif
 } coro_thread_t;
 thrd_static(coro_thread_t, coro, nullptr)
 
@@ -218,10 +504,29 @@ thrd_static(coro_thread_t, coro, nullptr)
  */
 static routine_t *RAII_EMPTY_T = (routine_t *)0x300, *RAII_ABORT_T = (routine_t *)0x400;
 make_atomic(routine_t *, atomic_routine_t)
-typedef struct {
+
+/* Set in `wait_state_t.pending` while `waiter` is suspended. */
+#define CORO_GROUP_WAITING ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1))
+
+/* Completion state of an `waitgroup`, members are pushed onto `done` as they finish,
+and `waiter` is woken once, by the member that drops `pending` to zero. */
+struct wait_state_s {
+    raii_type type;
+    bool is_legacy;
+    waitgroup_t wg;
+    routine_t *waiter;
+    wait_state_t *next;
+    atomic_size_t pending;
+    atomic_routine_t done;
+};
+
+typedef struct deque_array_s deque_array_t;
+struct deque_array_s {
     atomic_size_t size;
+    /* smaller array replaced by `deque_resize`, stealers may still read it */
+    deque_array_t *retired;
     atomic_routine_t buffer[];
-} deque_array_t;
+};
 
 make_atomic(deque_array_t *, atomic_coro_array_t)
 struct raii_deque_s {
@@ -235,19 +540,35 @@ struct raii_deque_s {
     atomic_flag started;
     atomic_flag shutdown;
 
+    /* cpu thread is pinned to, `RAII_ERR` if not */
+    int cpu;
+
     /* Used to determent which thread's `run queue`
     receive next `coroutine` task, `counter % cpu cores` */
     atomic_size_t cpu_id_count;
     atomic_size_t available;
     atomic_size_t steal_count;
+    /* stolen coroutines already counted by this worker, not yet settled */
+    atomic_size_t steal_given;
+    atomic_size_t steal_taken;
+    atomic_size_t steal_attempts;
+    atomic_size_t steal_failures;
 
     /* Assume that they never overflow */
     atomic_size_t top, bottom;
+    /* `deque_push` is called by any thread, not only the owner */
+    atomic_spinlock push_lock;
     atomic_coro_array_t array;
 
+    /* parked coroutines woken by other threads, only taken by owning thread */
+    atomic_routine_t inbox;
+    /* fd waits other threads cancelled, dropped by owning thread's reactor */
+    atomic_size_t io_cancels;
+
     cacheline_pad_t pad;
     raii_deque_t **local;
     cacheline_pad_t pad_;
+    coro_counters_t counters;
 };
 make_atomic(raii_deque_t *, thread_deque_t)
 
@@ -275,20 +596,35 @@ static void deque_init(raii_deque_t *q, u32 size_hint) {
     atomic_init(&a->size, size_hint);
     atomic_init(&q->array, a);
     atomic_init(&q->available, 0);
+    atomic_init(&q->inbox, nullptr);
     atomic_init(&q->steal_count, 0);
+    atomic_init(&q->steal_given, 0);
+    atomic_init(&q->steal_taken, 0);
+    atomic_init(&q->steal_attempts, 0);
+    atomic_init(&q->steal_failures, 0);
     atomic_init(&q->cpu_id_count, 0);
+    atomic_init(&q->counters.switches, 0);
+    atomic_init(&q->counters.spawned, 0);
+    atomic_init(&q->counters.completed, 0);
+    atomic_init(&q->counters.queued, 0);
+    atomic_init(&q->counters.sleeping, 0);
+    atomic_init(&q->counters.idle_ns, 0);
+    atomic_init(&q->counters.parked, 0);
+    atomic_init(&q->counters.started, 0);
+    atomic_flag_clear(&q->push_lock);
     atomic_flag_clear(&q->shutdown);
     atomic_flag_clear(&q->started);
     atomic_flag_test_and_set(&q->taken);
     q->grouped = nullptr;
     q->local = nullptr;
+    q->cpu = RAII_ERR;
     q->type = RAII_POOL;
 }
 
-static void deque_resize(raii_deque_t *q) {
+/* Grow to `new_size`, caller holds `push_lock`. */
+static void deque_resize(raii_deque_t *q, size_t new_size) {
     deque_array_t *a = (deque_array_t *)atomic_load_explicit(&q->array, memory_order_relaxed);
     size_t old_size = a->size;
-    size_t new_size = old_size * 2;
     deque_array_t *new = try_calloc(1, sizeof(deque_array_t) + sizeof(routine_t *) * new_size);
     atomic_init(&new->size, new_size);
     size_t i, t = atomic_load_explicit(&q->top, memory_order_relaxed);
@@ -296,7 +632,8 @@ static void deque_resize(raii_deque_t *q) {
     for (i = t; i < b; i++)
         new->buffer[i % new_size] = a->buffer[i % old_size];
 
-    atomic_store_explicit(&q->array, new, memory_order_relaxed);
+    new->retired = a;
+    atomic_store_explicit(&q->array, new, memory_order_release);
     /* The question arises as to the appropriate timing for releasing memory
      * associated with the previous array denoted by *a. In the original Chase
      * and Lev paper, this task was undertaken by the garbage collector, which
@@ -305,13 +642,12 @@ static void deque_resize(raii_deque_t *q) {
      *
      * In our context, the responsible deallocation of *a cannot occur at this
      * point, as another thread could potentially be in the process of reading
-     * from it. Thus, we opt to abstain from freeing *a in this context,
-     * resulting in memory leakage. It is worth noting that our expansion
-     * strategy for these queues involves consistent doubling of their size;
-     * this design choice ensures that any leaked memory remains bounded by the
-     * memory actively employed by the functional queues.
+     * from it. Thus, we keep *a in `retired`, released by `deque_free`.
+     * It is worth noting that our expansion strategy for these queues involves
+     * consistent doubling of their size; this design choice ensures that any
+     * retired memory remains bounded by the memory actively employed by the
+     * functional queues.
      */
-    free(a);
 }
 
 static routine_t *deque_take(raii_deque_t *q) {
@@ -342,17 +678,19 @@ static routine_t *deque_take(raii_deque_t *q) {
 }
 
 static void deque_push(raii_deque_t *q, routine_t *w) {
+    atomic_lock(&q->push_lock);
     size_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
     size_t t = atomic_load_explicit(&q->top, memory_order_acquire);
     deque_array_t *a = (deque_array_t *)atomic_load_explicit(&q->array, memory_order_relaxed);
     if (b - t > a->size - 1) { /* Full queue */
-        deque_resize(q);
+        deque_resize(q, a->size * 2);
         a = (deque_array_t *)atomic_load_explicit(&q->array, memory_order_relaxed);
     }
 
     atomic_store_explicit(&a->buffer[b % a->size], w, memory_order_relaxed);
     atomic_thread_fence(memory_order_release);
     atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    atomic_unlock(&q->push_lock);
 }
 
 static routine_t *deque_steal(raii_deque_t *q) {
@@ -374,11 +712,12 @@ static routine_t *deque_steal(raii_deque_t *q) {
 }
 
 static void deque_free(raii_deque_t *q) {
-    deque_array_t *a = nullptr;
+    deque_array_t *a = nullptr, *retired;
     if (!is_empty(q)) {
         a = atomic_get(deque_array_t *, &q->array);
-        if (!is_empty(a)) {
-            atomic_store(&q->array, nullptr);
+        atomic_store(&q->array, nullptr);
+        for (; !is_empty(a); a = retired) {
+            retired = a->retired;
             free((void_t)a);
         }
 
@@ -388,14 +727,18 @@ static void deque_free(raii_deque_t *q) {
 }
 
 static void deque_destroy(void) {
+    coro_stats_stop();
     if (is_type(gq_result.queue, RAII_POOL)) {
         raii_deque_t *queue = gq_result.queue;
         memory_t *scope = queue->scope;
         size_t i;
         queue->type = RAII_ERR;
         if (!is_empty(queue->local)) {
-            for (i = 1; i < gq_result.thread_count; i++) {
+            for (i = 1; i < gq_result.thread_count; i++)
                 atomic_flag_test_and_set(&queue->local[i]->shutdown);
+
+            coro_unpark();
+            for (i = 1; i < gq_result.thread_count; i++) {
                 if (atomic_flag_load(&gq_result.is_errorless))
                     thrd_join(queue->local[i]->thread, nullptr);
                 else
@@ -403,15 +746,18 @@ static void deque_destroy(void) {
             }
         }
 
+        coro_fs_shutdown();
+
         atomic_flag_test_and_set(&queue->shutdown);
         raii_delete(scope);
+        /* Also registered with `atexit`, after `coro_cleanup` already ran. */
+        gq_result.queue = nullptr;
 
-        result_t *r = atomic_get(result_t *, &gq_result.results);
-        if (!is_empty(r)) {
-            atomic_store(&gq_result.results, nullptr);
-            free((void_t)r);
-        }
+        raii_result_destroy();
     }
+
+    coro_profile_free();
+    coro_trace_free();
 }
 
 static routine_t *deque_peek(raii_deque_t *q, u32 index) {
@@ -422,11 +768,70 @@ static routine_t *deque_peek(raii_deque_t *q, u32 index) {
     return nullptr;
 }
 
+/* Jobs `deque` of an `thrd_async/thrd_spawn` pool worker, in `future.c`, any thread pushes,
+owner pops newest from `bottom`, others steal oldest from `top`. */
+raii_deque_t *raii_deque_create(u32 size_hint) {
+    raii_deque_t *q = try_calloc(1, sizeof(raii_deque_t));
+    deque_init(q, size_hint);
+    return q;
+}
+
+void raii_deque_push(raii_deque_t *q, void_t job) {
+    deque_push(q, (routine_t *)job);
+}
+
+/* Owner takes from `bottom`, serialized with pushes by `push_lock`, `nullptr` if empty. */
+void_t raii_deque_pop(raii_deque_t *q) {
+    routine_t *x = nullptr;
+    atomic_lock(&q->push_lock);
+    size_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+    if (t < b) {
+        deque_array_t *a = (deque_array_t *)atomic_load_explicit(&q->array, memory_order_relaxed);
+        atomic_store_explicit(&q->bottom, --b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        t = atomic_load_explicit(&q->top, memory_order_relaxed);
+        if (t <= b) {
+            x = (routine_t *)atomic_load_explicit(&a->buffer[b % a->size], memory_order_relaxed);
+            if (t == b) {
+                /* Single last job in queue */
+                if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                             memory_order_seq_cst,
+                                                             memory_order_relaxed))
+                    /* Failed race */
+                    x = nullptr;
+                atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+            }
+        } else {
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    atomic_unlock(&q->push_lock);
+
+    return x;
+}
+
+/* Steal from `top`, retrying lost races, `nullptr` if empty. */
+void_t raii_deque_steal(raii_deque_t *q) {
+    routine_t *x;
+    while ((x = deque_steal(q)) == RAII_ABORT_T)
+        ;
+
+    return x == RAII_EMPTY_T ? nullptr : x;
+}
+
+/* Free `q`, with every array `deque_resize` replaced. */
+void raii_deque_free(raii_deque_t *q) {
+    deque_free(q);
+}
+
 static void coro_transfer(raii_deque_t *queue);
 static void coro_destroy(void);
 static void coro_scheduler(void);
 /* Delete specified coroutine. */
 static void coro_delete(routine_t *co);
+static void coro_group_add(routine_t *c, routine_t *t);
+static void coro_group_done(routine_t *t);
 
 static RAII_INLINE void coro_interrupter(void) {
     if (coro_interrupt_set) {
@@ -467,15 +872,14 @@ static RAII_INLINE bool coro_sched_is_assignable(size_t active) {
 
 static RAII_INLINE void coro_result_set(routine_t *co, void_t data) {
 	if (!is_empty(data) && is_addressable(co) && co->rid != RAII_ERR) {
-        rid_t id = co->rid;
-        raii_values_t *result = (raii_values_t *)calloc_full(gq_result.scope, 1, sizeof(raii_values_t), free);
-        result_t *results = (result_t *)atomic_load_explicit(&gq_result.results, memory_order_acquire);
-        atomic_thread_fence(memory_order_seq_cst);
-        results[id]->result = result;
-        results[id]->result->valued.object = data;
-        co->results = &results[id]->result->valued;
-        results[id]->is_ready = true;
-        atomic_store_explicit(&gq_result.results, results, memory_order_release);
+        result_t result = raii_result_get(co->rid);
+        if (is_type(result, RAII_VALUE)) {
+            result->result = &result->value;
+            result->result->valued.object = data;
+            co->results = &result->result->valued;
+            atomic_thread_fence(memory_order_release);
+            result->is_ready = true;
+        }
     }
 }
 
@@ -496,7 +900,9 @@ static void coro_done(void) {
 
 static void coro_awaitable(void) {
     routine_t *co = coro_active();
-    array_deferred_set((arrays_t)co->args, co->scope);
+    /* Thread's main coroutine gets it's `deque`, not an `array` of arguments. */
+    if (co->run_code != CORO_RUN_THRD)
+        array_deferred_set((arrays_t)co->args, co->scope);
 
     try {
         if (co->interrupt_active) {
@@ -531,31 +937,45 @@ static void coro_func(void) {
     coro_done(); /* called only if coroutine function returns */
 }
 
-/* Add coroutine to scheduler queue, appending. */
+/* Add coroutine to scheduler queue, appending to it's level,
+or before any later deadline. */
 static void coro_add(scheduler_t *l, routine_t *t) {
-    if (l->tail) {
-        l->tail->next = t;
-        t->prev = l->tail;
-    } else {
-        l->head = t;
-        t->prev = nullptr;
+    run_level_t *lv = &l->level[CORO_RUN_LEVEL(t)];
+    routine_t *at = lv->tail;
+
+    if (t->deadline) {
+        while (at && at->deadline > t->deadline)
+            at = at->prev;
     }
 
-    l->tail = t;
-    t->next = nullptr;
+    t->prev = at;
+    t->next = at ? at->next : lv->head;
+    if (t->next)
+        t->next->prev = t;
+    else
+        lv->tail = t;
+
+    if (at)
+        at->next = t;
+    else
+        lv->head = t;
+
+    l->count++;
 }
 
-/* Remove coroutine from scheduler queue. */
-static void coro_remove(scheduler_t *l, routine_t *t) {
+/* Remove coroutine from scheduler queue level. */
+static void coro_remove(scheduler_t *l, run_level_t *lv, routine_t *t) {
     if (t->prev)
         t->prev->next = t->next;
     else
-        l->head = t->next;
+        lv->head = t->next;
 
     if (t->next)
         t->next->prev = t->prev;
     else
-        l->tail = t->prev;
+        lv->tail = t->prev;
+
+    l->count--;
 }
 
 /* Transfer tasks from `global` run queue to current thread's `local` run queue. */
@@ -564,10 +984,18 @@ static void coro_atomic_enqueue(routine_t *t) {
     raii_deque_t *queue = gq_result.queue->local[t->tid];
     deque_push(queue, t);
     atomic_fetch_add(&queue->available, 1);
-    atomic_thread_fence(memory_order_release);
+    coro_unpark();
 }
 
 RAII_INLINE void coro_enqueue(routine_t *t) {
+    /* Parked in reactor, resumed early only by cancelling it's fd wait. */
+    if (t->io_active) {
+        coro_io_cancel(t);
+        return;
+    } else if (t->parked) {
+        return;
+    }
+
     t->ready = true;
     /* Don't add initial coroutine representing main/child thread to local `deque` run queue.
     Also when flagged, a coroutine being added while system in interruption state. */
@@ -577,21 +1005,103 @@ RAII_INLINE void coro_enqueue(routine_t *t) {
             || (!coro()->is_main
                 && t->run_code == CORO_RUN_THRD && !coro()->started))) {
         coro_add(coro()->run_queue, t);
+    } else if (t == coro()->running) {
+        /* Could be stolen from `deque`, and resumed before it's context is saved. */
+        t->requeue = true;
     } else {
         coro_atomic_enqueue(t);
     }
 }
 
-static RAII_INLINE routine_t *coro_dequeue(scheduler_t *l) {
-    routine_t *t = nullptr;
-    if (l->head != nullptr) {
-        t = l->head;
-        coro_remove(l, t);
+/* Coroutines parked on another thread can't be pushed onto that thread's `deque`,
+it may still be running, between releasing what it waits on, and switching out. */
+void coro_wake(routine_t *t) {
+    raii_deque_t *queue;
+    routine_t *head;
+
+    coro_traced(CORO_TRACE_WAKE, t->cid, t->tid);
+    if (!coro_is_threading() || t->tid == coro()->thrd_id) {
+        coro_timeout_cancel(t);
+        t->parked = false;
+        coro_enqueue(t);
+        return;
+    }
+
+    queue = gq_result.queue->local[t->tid];
+    do {
+        head = (routine_t *)atomic_load(&queue->inbox);
+        t->wake_next = head;
+    } while (!atomic_compare_exchange_weak(&queue->inbox, &head, t));
+
+    coro_unpark();
+    coro_reactor_wake();
+}
+
+/* Move coroutines other threads woke, to calling thread's run queue. */
+static void coro_inbox_take(raii_deque_t *queue) {
+    routine_t *next, *t = (routine_t *)atomic_exchange(&queue->inbox, nullptr);
+    for (; !is_empty(t); t = next) {
+        next = t->wake_next;
+        coro_timeout_cancel(t);
+        t->parked = false;
+        t->ready = true;
+        coro_add(coro()->run_queue, t);
+    }
+}
+
+/* Take from highest level waiting, unless an lower one was passed over
+`CORO_PRIORITY_AGING` times, then the lowest such level runs instead. */
+static routine_t *coro_dequeue(scheduler_t *l) {
+    run_level_t *lv, *pick = nullptr;
+    routine_t *t;
+    int i;
+
+    if (l->count == 0)
+        return nullptr;
+
+    for (i = 0; i < CORO_RUN_LEVELS; i++) {
+        lv = &l->level[i];
+        if (lv->head == nullptr)
+            continue;
+
+        if (is_empty(pick) || ++lv->passed >= CORO_PRIORITY_AGING)
+            pick = lv;
     }
 
+    pick->passed = 0;
+    t = pick->head;
+    coro_remove(l, pick, t);
+
     return t;
 }
 
+/* Counters of calling thread, before `coro_pool_init` any updates are discarded. */
+static coro_counters_t *coro_counters(void) {
+    static coro_counters_t discarded;
+    raii_deque_t *queue;
+
+    if (is_empty(coro()->counters)) {
+        if (is_empty(queue = gq_result.queue) || queue->type != RAII_POOL)
+            return &discarded;
+
+        if (!is_empty(queue->local))
+            queue = queue->local[coro()->thrd_id];
+
+        coro()->counters = &queue->counters;
+        if (atomic_load(&queue->counters.started) == 0)
+            atomic_store(&queue->counters.started, get_timer());
+    }
+
+    return coro()->counters;
+}
+
+/* Single writer, no need for an atomic read-modify-write. */
+static RAII_INLINE void coro_count(atomic_size_t *counter, size_t n) {
+    atomic_store_explicit(counter,
+                          atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
 #ifdef MPROTECT
 alignas(4096)
 #else
@@ -1562,6 +2072,156 @@ static RAII_INLINE void coro_scheduler(void) {
     coro_switch(coro()->main_handle);
 }
 
+/* Return stack pool size class for `size`, `RAII_ERR` if too large to recycle. */
+static RAII_INLINE i32 coro_pool_class(size_t size) {
+    i32 pool_class = 0;
+    while (((size_t)CORO_STACK_SIZE << pool_class) < size)
+        if (++pool_class == CORO_POOL_CLASSES)
+            return RAII_ERR;
+
+    return pool_class;
+}
+
+#if defined(USE_MMAP_STACK)
+/* Offset of guard page, placed between `routine_t` header and stack,
+stack overflows will fault on guard page before reaching header. */
+static RAII_INLINE size_t coro_stack_guard(void) {
+    if (!coro_page_size)
+        coro_page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    return _coro_align_forward(sizeof(routine_t), coro_page_size);
+}
+
+/* Check if `addr` is within guard page of current coroutine. */
+static bool coro_stack_guarded(void_t addr) {
+    routine_t *co = coro()->active_handle;
+    char *page;
+
+    if (is_empty(co) || co == coro()->active_buffer)
+        return false;
+
+    page = (char *)co + coro_stack_guard();
+    return (char *)addr >= page && (char *)addr < page + coro_page_size;
+}
+
+/* Reserve stack memory with `mmap`, pages are only committed when touched. */
+static void_t coro_stack_map(size_t size) {
+    char *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+#if defined(MAP_STACK)
+                        | MAP_STACK
+#endif
+                        , -1, 0);
+    if (memory == MAP_FAILED) {
+        errno = ENOMEM;
+        raii_panic("Mmap failed!");
+    }
+
+    if (mprotect(memory + coro_stack_guard(), coro_page_size, PROT_NONE) < 0) {
+        munmap(memory, size);
+        raii_panic("Mprotect failed!");
+    }
+
+    return (void_t)memory;
+}
+#endif
+
+/* Release coroutine stack memory back to the allocator/system. */
+static void coro_stack_free(routine_t *co) {
+#if defined(USE_MMAP_STACK)
+    /* Exception context of `main` coroutine frames stays referenced by thread
+    until process exit, an unmapped stack would fault, so keep it mapped. */
+    if (co->run_code != CORO_RUN_MAIN)
+        munmap((void_t)co, co->stack_size);
+#else
+    free(co);
+#endif
+}
+
+/* Collect thread stack pool counters into global counters. */
+static void coro_pool_collect(void) {
+    if (coro()->pool_hits) {
+        atomic_fetch_add(&stack_pool_hits, coro()->pool_hits);
+        coro()->pool_hits = 0;
+    }
+
+    if (coro()->pool_misses) {
+        atomic_fetch_add(&stack_pool_misses, coro()->pool_misses);
+        coro()->pool_misses = 0;
+    }
+
+    if (coro()->pool_trimmed) {
+        atomic_fetch_add(&stack_pool_trimmed, coro()->pool_trimmed);
+        coro()->pool_trimmed = 0;
+    }
+}
+
+/* Get stack memory of `size` bytes, reusing an recycled stack of `pool_class` if available. */
+static void_t coro_stack_acquire(i32 pool_class, size_t size) {
+    routine_t *co;
+    if (pool_class != RAII_ERR && !is_empty(co = coro()->stack_pool[pool_class])) {
+        coro()->stack_pool[pool_class] = co->next;
+        coro()->pool_count[pool_class]--;
+        coro()->pool_hits++;
+        /* Only the `routine_t` header and trailing values need clearing, not the stack. */
+        memset((void_t)co, 0, sizeof(routine_t));
+        memset((char *)co + size - sizeof(raii_values_t), 0, sizeof(raii_values_t));
+        return (void_t)co;
+    }
+
+    coro()->pool_misses++;
+#if defined(USE_MMAP_STACK)
+    return coro_stack_map(size);
+#else
+    return try_calloc(1, size);
+#endif
+}
+
+/* Return coroutine stack memory to thread pool, or `free` if pool full/not recyclable. */
+static void coro_stack_release(routine_t *co) {
+    i32 pool_class = co->pool_class;
+    co->magic_number = RAII_ERR;
+    if (pool_class != RAII_ERR && co->run_code != CORO_RUN_MAIN
+        && coro()->pool_count[pool_class] < CORO_POOL_LIMIT) {
+        co->next = coro()->stack_pool[pool_class];
+        coro()->stack_pool[pool_class] = co;
+        coro()->pool_count[pool_class]++;
+    } else {
+        coro_stack_free(co);
+    }
+}
+
+RAII_INLINE void coro_stack_pool_trim(u32 keep) {
+    routine_t *co;
+    i32 i;
+    for (i = 0; i < CORO_POOL_CLASSES; i++) {
+        while (coro()->pool_count[i] > keep) {
+            co = coro()->stack_pool[i];
+            coro()->stack_pool[i] = co->next;
+            coro()->pool_count[i]--;
+            coro()->pool_trimmed++;
+            coro_stack_free(co);
+        }
+    }
+
+    coro_pool_collect();
+}
+
+stack_pool_stats_t coro_stack_pool_stats(void) {
+    stack_pool_stats_t stats;
+    i32 i;
+
+    coro_pool_collect();
+    stats.hits = atomic_load(&stack_pool_hits);
+    stats.misses = atomic_load(&stack_pool_misses);
+    stats.trimmed = atomic_load(&stack_pool_trimmed);
+    stats.cached = 0;
+    for (i = 0; i < CORO_POOL_CLASSES; i++)
+        stats.cached += coro()->pool_count[i];
+
+    return stats;
+}
+
 /* Delete specified coroutine. */
 static void coro_delete(routine_t *co) {
     if (!co) {
@@ -1579,8 +2239,11 @@ static void coro_delete(routine_t *co) {
             co->interrupt_active = false;
             co->is_waiting = false;
         } else if (co->magic_number == CORO_MAGIC_NUMBER) {
-            co->magic_number = RAII_ERR;
-            free(co);
+            /* Nothing to collect, recycle `result` slot now. */
+            if (co->rid != RAII_ERR && is_empty(co->results))
+                raii_result_free(co->rid);
+
+            coro_stack_release(co);
         }
     }
 }
@@ -1596,8 +2259,11 @@ RAII_INLINE void coro_stack_check(int n) {
 }
 
 static RAII_INLINE void coro_yielding(routine_t *co) {
+#if !defined(USE_MMAP_STACK)
+    /* With guard pages, overflows fault instead, raised as `stack_overflow`. */
     if (!coro()->interrupter_active)
         coro_stack_check(0);
+#endif
 
     coro_switch(co);
 }
@@ -1613,6 +2279,7 @@ RAII_INLINE bool coro_terminated(routine_t *co) {
 
 /* Create new coroutine. */
 static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
+    i32 pool_class;
 #if defined(__powerpc64__) && !defined(USE_UCONTEXT) && !defined(USE_SJLJ)
     if ((heapsize != 0 && heapsize < PPC_MIN_STACK) || heapsize == 0)
         heapsize = PPC_MIN_STACK;
@@ -1622,8 +2289,18 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
         heapsize = CORO_STACK_SIZE;
 #endif
 
+    /* Round up to size class, so any recycled stack of that class fits. */
+    if ((pool_class = coro_pool_class(heapsize)) != RAII_ERR)
+        heapsize = (size_t)CORO_STACK_SIZE << pool_class;
+
+#if defined(USE_MMAP_STACK)
+    /* Layout: `routine_t` header, guard page, then stack, all page aligned. */
+    heapsize = coro_stack_guard() + coro_page_size + _coro_align_forward(heapsize, coro_page_size);
+#else
     heapsize = _coro_align_forward(heapsize + sizeof(routine_t), 16); /* Stack size should be aligned to 16 bytes. */
-    void_t memory = try_calloc(1, heapsize + sizeof(raii_values_t));
+#endif
+    void_t memory = coro_stack_acquire(pool_class, heapsize + sizeof(raii_values_t));
+    ((routine_t *)memory)->pool_class = pool_class;
     routine_t *co = coro_derive(memory, heapsize);
 
     if (!coro()->current_handle)
@@ -1633,7 +2310,7 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
         coro()->main_handle = coro()->active_handle;
 
     if (UNLIKELY(raii_deferred_init(&co->scope->defer) < 0)) {
-        free(co);
+        coro_stack_release(co);
         return (routine_t *)RAII_ERR;
     }
 
@@ -1646,6 +2323,8 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
     co->ready = false;
     co->flagged = false;
     co->run_code = CORO_RUN_NORMAL;
+    co->priority = CORO_PRIORITY_NORMAL;
+    co->deadline = 0;
     co->taken = false;
     co->wait_active = false;
     co->wait_group = nullptr;
@@ -1656,7 +2335,19 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
     co->is_event_err = false;
     co->is_waiting = false;
     co->is_group = false;
+    co->group = nullptr;
+    co->groups = nullptr;
+    co->group_next = nullptr;
+    co->wake_next = nullptr;
     co->is_generator = false;
+    co->io_active = false;
+    co->io_cancelled = false;
+    co->io_wait_fd = RAII_ERR;
+    atomic_flag_clear(&co->io_cancel);
+    co->parked = false;
+    co->requeue = false;
+    co->posted = false;
+    co->park_claim = nullptr;
     co->gen_id = RAII_ERR;
     co->is_group_finish = true;
     co->interrupt_timers = 0;
@@ -1666,7 +2357,12 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
     co->user_data = nullptr;
     co->yield = nullptr;
     co->scope->is_protected = false;
+    co->scope->region = nullptr;
+#if defined(USE_MMAP_STACK)
+    co->stack_base = (unsigned char *)co + coro_stack_guard() + coro_page_size;
+#else
     co->stack_base = (unsigned char *)(co + 1);
+#endif
     co->magic_number = CORO_MAGIC_NUMBER;
     if (coro_interrupt_set && is_empty(coro()->interrupt_handle))
         coro_interrupt_init();
@@ -1676,16 +2372,21 @@ static routine_t *coro_create(size_t heapsize, raii_func_t func, void_t args) {
 
 /* Create a new coroutine running func(arg) with stack size
 and startup type: `CORO_RUN_NORMAL`, `CORO_RUN_MAIN`, `CORO_RUN_SYSTEM`, `CORO_RUN_EVENT`. */
-static rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
+/* Assign ids, `waitgroup`, and thread of new coroutine `t`, then enqueue it. */
+static rid_t coro_setup(routine_t *t, run_mode code) {
     rid_t id;
     bool is_assigning, is_thread, is_group, not_resultable;
-    routine_t *t = coro_create(stack, fn, arg);
     routine_t *c = coro_active();
 
     t->run_code = code;
     if (c->interrupt_active || c->event_active)
         t->run_code = CORO_RUN_EVENT;
 
+    t->priority = coro()->spawn_priority;
+    t->deadline = coro()->spawn_deadline;
+    coro()->spawn_priority = CORO_PRIORITY_NORMAL;
+    coro()->spawn_deadline = 0;
+
     not_resultable = t->run_code == CORO_RUN_THRD || t->run_code == CORO_RUN_SYSTEM
         || t->run_code == CORO_RUN_INTERRUPT;
     if (not_resultable)
@@ -1695,6 +2396,7 @@ static rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
 
     t->cid = (u32)atomic_fetch_add(&gq_result.id_generate, 1) + 1;
     t->tid = coro()->thrd_id;
+    coro_count(&coro_counters()->spawned, 1);
     is_group = c->wait_active && !is_empty(c->wait_group) && !c->is_group_finish
         && is_empty(c->event_group);
     if (coro_is_threading()) {
@@ -1714,6 +2416,7 @@ static rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
         coro()->used_count++;
     }
 
+    coro_traced(CORO_TRACE_SPAWN, t->cid, t->tid);
     id = t->rid;
     if (c->event_active && !is_empty(c->event_group) && id != RAII_ERR) {
         t->event_active = true;
@@ -1723,6 +2426,7 @@ static rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
     } else if (is_group && id != RAII_ERR) {
         t->is_waiting = true;
         t->is_group = true;
+        coro_group_add(c, t);
         hash_put(c->wait_group, __itoa(id), t);
     }
 
@@ -1740,6 +2444,21 @@ static rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
     return id;
 }
 
+static RAII_INLINE rid_t create_coro(raii_func_t fn, void_t arg, u32 stack, run_mode code) {
+    return coro_setup(coro_create(stack, fn, arg), code);
+}
+
+/* Create coroutine with `num_of_args` arguments in `ap`, up to `CORO_INLINE_ARGS`
+are kept in coroutine's own storage, no allocation or `defer` needed. */
+static rid_t coro_spawn(raii_func_t fn, u64 num_of_args, va_list ap, u32 stack, run_mode code) {
+    routine_t *t = coro_create(stack, fn, nullptr);
+    if (num_of_args > CORO_INLINE_ARGS
+        || is_empty(t->args = array_inline(t->args_inline, sizeof(t->args_inline), t->scope, num_of_args, ap)))
+        t->args = array_ex(coro_scope(), num_of_args, ap);
+
+    return coro_setup(t, code);
+}
+
 void coro_name(char *fmt, ...) {
     va_list args;
     routine_t *t = coro()->running;
@@ -1823,9 +2542,107 @@ static uint64_t nsec(void) {
 	return (uint64_t)tv.tv_sec * 1000 * 1000 * 1000 + tv.tv_usec * 1000;
 }
 
+/* Store coroutine at sleep heap position `i`. */
+static RAII_INLINE void coro_timeout_set(u32 i, routine_t *t) {
+    coro()->sleep_heap[i] = t;
+    t->sleep_index = i + 1;
+}
+
+static void coro_timeout_up(u32 i) {
+    routine_t **heap = coro()->sleep_heap, *t = heap[i];
+    u32 parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 4;
+        if (heap[parent]->alarm_time <= t->alarm_time)
+            break;
+
+        coro_timeout_set(i, heap[parent]);
+        i = parent;
+    }
+
+    coro_timeout_set(i, t);
+}
+
+static void coro_timeout_down(u32 i) {
+    routine_t **heap = coro()->sleep_heap, *t = heap[i];
+    u32 child, last, min, size = coro()->sleep_size;
+
+    while ((child = i * 4 + 1) < size) {
+        last = child + 4 < size ? child + 4 : size;
+        for (min = child++; child < last; child++) {
+            if (heap[child]->alarm_time < heap[min]->alarm_time)
+                min = child;
+        }
+
+        if (t->alarm_time <= heap[min]->alarm_time)
+            break;
+
+        coro_timeout_set(i, heap[min]);
+        i = min;
+    }
+
+    coro_timeout_set(i, t);
+}
+
+/* Add coroutine to thread's sleep heap, `O(log n)`. */
+static void coro_timeout_push(routine_t *t) {
+    if (coro()->sleep_size == coro()->sleep_capacity) {
+        coro()->sleep_capacity = coro()->sleep_capacity ? coro()->sleep_capacity * 2 : 64;
+        coro()->sleep_heap = try_realloc(coro()->sleep_heap, coro()->sleep_capacity * sizeof(routine_t *));
+    }
+
+    coro()->sleep_heap[coro()->sleep_size++] = t;
+    coro_timeout_up(coro()->sleep_size - 1);
+}
+
+/* Remove coroutine from anywhere in thread's sleep heap, `O(log n)`. */
+static void coro_timeout_remove(routine_t *t) {
+    u32 i = t->sleep_index - 1;
+    routine_t *last;
+
+    if (t->sleep_index == 0)
+        return;
+
+    t->sleep_index = 0;
+    last = coro()->sleep_heap[--coro()->sleep_size];
+    if (last != t) {
+        coro_timeout_set(i, last);
+        if (i > 0 && coro()->sleep_heap[(i - 1) / 4]->alarm_time > last->alarm_time)
+            coro_timeout_up(i);
+        else
+            coro_timeout_down(i);
+    }
+}
+
+/* Drop deadline of an `coro_park_for` coroutine some waker resumed, on it's owning thread. */
+static void coro_timeout_cancel(routine_t *t) {
+    if (is_empty(t->park_claim) || t->sleep_index == 0)
+        return;
+
+    coro_timeout_remove(t);
+    if (!t->system && --coro()->sleeping_counted == 0)
+        coro()->used_count--;
+}
+
+/* Claim `coro_park_for` coroutine for it's timer, `false` when an waker got there first. */
+static RAII_INLINE bool coro_park_expire(routine_t *t) {
+    size_t pending = 0;
+    return atomic_compare_exchange_strong(t->park_claim, &pending, CORO_PARK_EXPIRED);
+}
+
+/* Release thread's sleep heap. */
+static void coro_timeout_free(void) {
+    if (!is_empty(coro()->sleep_heap)) {
+        free(coro()->sleep_heap);
+        coro()->sleep_heap = nullptr;
+        coro()->sleep_size = coro()->sleep_capacity = 0;
+    }
+}
+
 static void_t coro_wait_system(void_t v) {
     routine_t *t;
-    size_t now;
+    size_t now, deadline;
     (void)v;
 
     coro_system();
@@ -1835,50 +2652,53 @@ static void_t coro_wait_system(void_t v) {
         coro_name("coro_wait_system #%d", (int)coro()->thrd_id);
 
     while (raii_is_running()) {
-        /* let everyone else run */
-        while (coro_yielding_active() > 0)
-            ;
+        /* let everyone else run, a busy yielder must not starve timers */
+        coro_yielding_active();
         now = get_timer();
         coro_info(coro_active(), 1);
-        while ((t = coro()->sleep_queue->head) && now >= t->alarm_time || (t && t->halt)) {
-            coro_remove(coro()->sleep_queue, t);
+        /* take all expired timers in one batch */
+        while (coro()->sleep_size > 0
+               && (now >= (t = coro()->sleep_heap[0])->alarm_time || t->halt)) {
+            coro_timeout_remove(t);
             if (!t->system && --coro()->sleeping_counted == 0)
                 coro()->used_count--;
 
+            if (!t->halt && !is_empty(t->park_claim)) {
+                /* lost to an waker, it's `coro_wake` will resume it */
+                if (!coro_park_expire(t))
+                    continue;
+
+                t->parked = false;
+            }
+
             if (!t->halt)
                 coro_enqueue(t);
         }
+
+        /* nothing runnable or expired, park until next deadline or new work */
+        deadline = coro()->sleep_size > 0 ? coro()->sleep_heap[0]->alarm_time : 0;
+        if (coro()->run_queue->count == 0 && !coro_interrupt_set
+            && (coro()->sleep_size == 0 || deadline > now)) {
+            /* nothing else runnable, thread is idle */
+            coro_stack_pool_trim(CORO_POOL_IDLE);
+            coro_park(coro_park_local, deadline ? deadline - now : 0);
+        }
     }
 
     return 0;
 }
 
-static void add_timeout(routine_t *running, routine_t *context, u32 ms, size_t now) {
-    size_t when = now + (size_t)ms * 1000000;
-    routine_t *t = nullptr;
-
-    for (t = coro()->sleep_queue->head; !is_empty(t) && t->alarm_time < when; t = t->next)
-        ;
-
-    if (t) {
-        context->prev = t->prev;
-        context->next = t;
-    } else {
-        context->prev = coro()->sleep_queue->tail;
-        context->next = nullptr;
+static void coro_sleep_activate(void) {
+    if (!coro()->sleep_activated) {
+        coro()->sleep_activated = true;
+        create_coro(coro_wait_system, nullptr, Kb(18), CORO_RUN_SYSTEM);
+        coro_stealer();
     }
+}
 
-    t = context;
-    t->alarm_time = when;
-    if (t->prev)
-        t->prev->next = t;
-    else
-        coro()->sleep_queue->head = t;
-
-    if (t->next)
-        t->next->prev = t;
-    else
-        coro()->sleep_queue->tail = t;
+static void add_timeout(routine_t *running, routine_t *context, u32 ms, size_t now) {
+    context->alarm_time = now + (size_t)ms * 1000000;
+    coro_timeout_push(context);
 
     if (!running->system && coro()->sleeping_counted++ == 0)
         coro()->used_count++;
@@ -1887,13 +2707,9 @@ static void add_timeout(routine_t *running, routine_t *context, u32 ms, size_t n
 u32 sleepfor(u32 ms) {
     size_t now;
 
-    if (!coro()->sleep_activated) {
-        coro()->sleep_activated = true;
-        create_coro(coro_wait_system, nullptr, Kb(18), CORO_RUN_SYSTEM);
-        coro_stealer();
-    }
-
+    coro_sleep_activate();
     now = get_timer();
+    coro_traced(CORO_TRACE_SLEEP, coro()->running->cid, ms);
     add_timeout(coro()->running, coro()->running, ms, now);
     if (coro_interrupt_set)
         coro_active()->interrupt_timers++;
@@ -1905,6 +2721,18 @@ u32 sleepfor(u32 ms) {
     return (u32)(get_timer() - now) / 1000000;
 }
 
+bool coro_park_for(atomic_size_t *claim, u32 ms) {
+    routine_t *t = coro_running();
+
+    coro_sleep_activate();
+    t->park_claim = claim;
+    add_timeout(t, t, ms, get_timer());
+    coro_suspend();
+    t->park_claim = nullptr;
+
+    return atomic_load(claim) != CORO_PARK_EXPIRED;
+}
+
 static void coro_sched_init(bool is_main, u32 thread_id) {
     coro()->stopped = false;
     coro()->started = false;
@@ -1915,8 +2743,10 @@ static void coro_sched_init(bool is_main, u32 thread_id) {
     coro()->sleeping_counted = 0;
     coro()->used_count = 0;
     coro()->group_count = 0;
-    coro()->seed = 0;
+    coro()->seed = thread_id + 1;
     coro()->stolen_count = 0;
+    coro()->steal_backoff = 0;
+    coro()->counters = nullptr;
     coro()->sleep_handle = nullptr;
     coro()->active_handle = nullptr;
     coro()->main_handle = nullptr;
@@ -1928,8 +2758,32 @@ static void coro_sched_init(bool is_main, u32 thread_id) {
     coro()->interrupt_data = nullptr;
     coro()->interrupt_bitset = nullptr;
     coro()->run_queue->type = RAII_SCHED;
-    coro()->sleep_queue->type = RAII_SCHED;
-}
+    coro()->spawn_priority = CORO_PRIORITY_NORMAL;
+    coro()->spawn_deadline = 0;
+    coro()->sleep_size = 0;
+#if defined(CORO_REACTOR)
+    coro()->io_fd = -1;
+    coro()->io_waiting = 0;
+    coro()->io_ticks = 0;
+    atomic_init(&coro()->fs_done, nullptr);
+#endif
+#if defined(CORO_URING)
+    coro()->ring->fd = -1;
+#endif
+#if defined(USE_MMAP_STACK)
+    if (is_empty(coro()->signal_stack)) {
+        stack_t stack;
+        coro()->signal_stack = try_calloc(1, Kb(64));
+        stack.ss_sp = coro()->signal_stack;
+        stack.ss_size = Kb(64);
+        stack.ss_flags = 0;
+        if (sigaltstack(&stack, nullptr) < 0)
+            RAII_LOG("Error: `sigaltstack`");
+    }
+
+    exception_guard_func = coro_stack_guarded;
+#endif
+}
 
 /* Check `thread` local coroutine use count for zero. */
 static RAII_INLINE bool coro_sched_empty(void) {
@@ -1943,7 +2797,7 @@ static RAII_INLINE bool coro_sched_is_stealable(void) {
 
 /* Check `local` run queue `head` for not `nullptr`. */
 static RAII_INLINE bool coro_sched_active(void) {
-    return coro()->run_queue->head != nullptr;
+    return coro()->run_queue->count != 0;
 }
 
 static RAII_INLINE bool coro_sched_is_sleeping(void) {
@@ -1967,6 +2821,16 @@ static void coro_unwind_setup(ex_context_t *ctx, const char *ex, const char *mes
     ex_unwind_set(ctx, co->scope->is_protected);
 }
 
+/* Mark `queue` as taken, the last thread to take, ends the posted `waitgroup` round. */
+static void coro_take_done(raii_deque_t *queue) {
+    atomic_flag_test_and_set(&queue->taken);
+    if (atomic_fetch_add(&gq_result.take_count, 1) + 1 == gq_result.thread_count) {
+        gq_result.is_takeable--;
+        atomic_store(&gq_result.take_count, 0);
+        atomic_flag_clear(&gq_result.is_waitable);
+    }
+}
+
 /* Check available coroutines in thread `deque` ~temp~ run queue.
 
 If `coroutine` in `waitgroup`, take all. Otherwise,
@@ -1976,11 +2840,15 @@ Note: only coroutines in `deque` ~temp~ run queue, can have work stealing applie
 static bool coro_take(raii_deque_t *queue, bool take_all) {
     size_t i, available, active;
     bool work_taken = false;
+    /* Settle coroutines counted here, but stolen by other threads. */
+    if (atomic_load_explicit(&queue->steal_given, memory_order_relaxed) > 0)
+        coro()->used_count -= (int)atomic_exchange(&queue->steal_given, 0);
+
     atomic_thread_fence(memory_order_seq_cst);
     if ((available = atomic_load_explicit(&queue->available, memory_order_relaxed)) > 0) {
         work_taken = true;
-        active = take_all || (available > (int)(atomic_load(&gq_result.active_count) - 1))
-            ? available : 1;
+        /* Leave half behind for idle threads to steal, unless taking all for `waitgroup`. */
+        active = take_all ? available : (available + 1) / 2;
         for (i = 0; i < active; i++) {
             routine_t *t = deque_steal(queue);
             if (t == RAII_ABORT_T) {
@@ -1995,24 +2863,20 @@ static bool coro_take(raii_deque_t *queue, bool take_all) {
             if (!t->taken) {
                 t->taken = true;
                 coro()->used_count++;
-                if (t->is_group)
+                if (t->is_group && is_empty(t->group))
                     coro()->group_count++;
             }
 
             coro_add(coro()->run_queue, t);
         }
 
-        if (take_all) {
-            atomic_flag_test_and_set(&queue->taken);
-            atomic_fetch_add(&gq_result.take_count, 1);
-            if (atomic_load_explicit(&gq_result.take_count, memory_order_relaxed) == gq_result.thread_count) {
-                gq_result.is_takeable--;
-                atomic_store(&gq_result.take_count, 0);
-                atomic_flag_clear(&gq_result.is_waitable);
-            }
-        }
+        coro_traced(CORO_TRACE_TAKE, 0, (u32)i);
     }
 
+    /* Count even when all was stolen, before getting here. */
+    if (take_all)
+        coro_take_done(queue);
+
     return work_taken;
 }
 
@@ -2036,8 +2900,13 @@ static void coro_transfer(raii_deque_t *queue) {
                         coro()->sleep_handle = t;
                     }
 
-                    t->tid = 0;
-                    coro_enqueue(t);
+                    if (!t->posted) {
+                        coro_traced(CORO_TRACE_TRANSFER, t->cid, t->tid);
+                        t->posted = true;
+                        t->tid = 0;
+                        coro_enqueue(t);
+                    }
+
                     if (++count == hash_count(wg))
                         break;
                 }
@@ -2064,6 +2933,7 @@ static void coro_transfer(raii_deque_t *queue) {
                             t->taken = false;
                         }
 
+                        coro_traced(CORO_TRACE_TRANSFER, t->cid, t->tid);
                         t->tid = 0;
                         coro_enqueue(t);
                     }
@@ -2077,19 +2947,144 @@ static void coro_transfer(raii_deque_t *queue) {
 
 static RAII_INLINE void coro_group_result_set(routine_t *co) {
     atomic_lock(&gq_result.group_lock);
-    if (!is_empty(gq_result.group_result))
+    /* Sized by `waitfor` for members, an moved array would leave it's deferred cleanup stale. */
+    if (!is_empty(gq_result.group_result)
+        && $size(gq_result.group_result) < $capacity(gq_result.group_result))
         $append_unsigned(gq_result.group_result, co->rid);
 
     atomic_unlock(&gq_result.group_lock);
 }
 
+/* Recycle any `result` slots in `waitgroup` results, not consumed by `result_for`. */
+static void coro_group_result_free(waitresult_t wgr) {
+    foreach(rid in wgr)
+        raii_result_free((rid_t)rid.max_size);
+}
+
+/* Find completion state for `wg` created by coroutine `c`. */
+static wait_state_t *coro_group_state(routine_t *c, waitgroup_t wg) {
+    wait_state_t *state;
+    for (state = c->groups; !is_empty(state); state = state->next) {
+        if (state->wg == wg)
+            return state;
+    }
+
+    return nullptr;
+}
+
+/* Add coroutine `t` as member of `c` current `waitgroup`, tracked by completion state. */
+static void coro_group_add(routine_t *c, routine_t *t) {
+    wait_state_t *state = coro_group_state(c, c->wait_group);
+    if (is_empty(state)) {
+        state = try_calloc(1, sizeof(wait_state_t));
+        state->type = RAII_SCHED;
+        state->wg = c->wait_group;
+        state->waiter = c;
+        state->next = c->groups;
+        /* `interrupt` members finish by switching to `waiter`, not thru `scheduler`. */
+        state->is_legacy = c->interrupt_active || coro_interrupt_set;
+        atomic_init(&state->pending, 0);
+        atomic_init(&state->done, nullptr);
+        c->groups = state;
+    }
+
+    if (!state->is_legacy) {
+        t->group = state;
+        atomic_fetch_add(&state->pending, 1);
+    }
+}
+
+/* Remove and free completion state from coroutine `c`. */
+static void coro_group_free(routine_t *c, wait_state_t *state) {
+    wait_state_t **p;
+    for (p = &c->groups; !is_empty(*p); p = &(*p)->next) {
+        if (*p == state) {
+            *p = state->next;
+            break;
+        }
+    }
+
+    state->type = RAII_ERR;
+    free(state);
+}
+
+/* Called by `scheduler` of any thread, when an `waitgroup` member finish. */
+static void coro_group_done(routine_t *t) {
+    wait_state_t *state = t->group;
+    routine_t *waiter = state->waiter, *head;
+
+    coro_traced(CORO_TRACE_GROUP_DONE, t->cid, waiter->cid);
+    t->group = nullptr;
+    do {
+        head = (routine_t *)atomic_load(&state->done);
+        t->group_next = head;
+    } while (!atomic_compare_exchange_weak(&state->done, &head, t));
+
+    /* `state` can be freed by `waiter` after this, don't touch. */
+    if (atomic_fetch_sub(&state->pending, 1) == (CORO_GROUP_WAITING | 1))
+        coro_enqueue(waiter);
+}
+
+/* Collect results of, and delete all finished members in `state` completion list. */
+static void coro_group_collect(wait_state_t *state) {
+    routine_t *next, *co = (routine_t *)atomic_exchange(&state->done, nullptr);
+    for (; !is_empty(co); co = next) {
+        next = co->group_next;
+        if (!is_empty(co->results) && co->rid != RAII_ERR)
+            coro_group_result_set(co);
+
+        coro_delete(co);
+    }
+}
+
+/* Enqueue members of `wg` not posted to thread pool, too few threads active to spread them. */
+static void coro_group_post(waitgroup_t wg) {
+    routine_t *t;
+    size_t i, count = 0, cap = hash_capacity(wg);
+    for (i = 0; i < cap && count < hash_count(wg); i++) {
+        if (t = ((routine_t *)hash_pair_value(hash_buckets(wg, i)).object)) {
+            count++;
+            if (t->status == CORO_SUSPENDED && !t->posted) {
+                t->posted = true;
+                coro_enqueue(t);
+            }
+        }
+    }
+}
+
+/* Suspend current coroutine until all members in `state` finish, collecting as they do. */
+static void coro_group_wait(wait_state_t *state) {
+    routine_t *c = coro_active();
+    size_t pending;
+
+    for (;;) {
+        coro_group_collect(state);
+        if ((pending = atomic_load(&state->pending)) == 0)
+            break;
+
+        if (pending == CORO_GROUP_WAITING) {
+            /* Last member finished, and resumed us. */
+            atomic_store(&state->pending, 0);
+            continue;
+        }
+
+        if (!(pending & CORO_GROUP_WAITING)
+            && !atomic_compare_exchange_strong(&state->pending, &pending, pending | CORO_GROUP_WAITING))
+            continue;
+
+        coro_info(c, 1);
+        coro_suspend();
+    }
+}
+
 static void coro_thread_waitfor(waitgroup_t wg) {
     routine_t *co, *c = coro_active();
     hash_pair_t *pair = nullptr;
     string_t key = nullptr;
     u32 cap, i, group_capacity = coro()->group_count;
     coro()->group_count = 0;
-    bool has_completed = false;
+    bool has_completed = false, has_local;
+    int ran;
 
     if (coro_interrupt_set && !atomic_flag_load(&gq_result.is_disabled)) {
         coro_flag_set(coro_running());
@@ -2098,6 +3093,8 @@ static void coro_thread_waitfor(waitgroup_t wg) {
 
     while (hash_count(wg) && !has_completed) {
         cap = (u32)hash_capacity(wg);
+        has_local = false;
+        ran = 0;
         for (i = 0; i < cap; i++) {
             if (group_capacity == 0) {
                 has_completed = true;
@@ -2108,7 +3105,10 @@ static void coro_thread_waitfor(waitgroup_t wg) {
                 key = hash_pair_key(pair);
                 if (co->tid != coro()->thrd_id) {
                     continue;
-                } else if (!coro_terminated(co)) {
+                }
+
+                has_local = true;
+                if (!coro_terminated(co)) {
                     if (!co->interrupt_active && co->status == CORO_NORMAL) {
                         if (coro_interrupt_set && !atomic_flag_load(&gq_result.is_disabled))
                             coro_flag_set(co);
@@ -2120,7 +3120,7 @@ static void coro_thread_waitfor(waitgroup_t wg) {
                     }
 
                     coro_info(c, 1);
-                    coro_yielding_active();
+                    ran += coro_yielding_active();
                 } else {
                     group_capacity--;
                     if (!is_empty(co->results) && co->rid != RAII_ERR)
@@ -2130,8 +3130,7 @@ static void coro_thread_waitfor(waitgroup_t wg) {
                         if (coro_queue_active_count() > 0)
                             atomic_fetch_sub(&gq_result.active_count, 1);
                         coro_deferred_free(co);
-                        co->magic_number = RAII_ERR;
-                        free(co);
+                        coro_stack_release(co);
                     } else {
                         coro_delete(co);
                     }
@@ -2140,6 +3139,14 @@ static void coro_thread_waitfor(waitgroup_t wg) {
                 }
             }
         }
+
+        /* Remaining members all on other threads, let scheduler drain wakes meanwhile. */
+        if (!has_completed && !has_local)
+            ran += coro_yielding_active();
+
+        /* Nothing else ran, members are parked or running elsewhere, give up the CPU. */
+        if (!has_completed && ran <= 0)
+            thrd_yield();
     }
     --coro()->used_count;
 }
@@ -2161,7 +3168,9 @@ static void_t coro_thread_main(void_t args) {
             queue->grouped = nullptr;
             coro_thread_waitfor(grouped);
         } else if (coro()->used_count > 1) {
-            yield();
+            /* rest parked, waiting on other threads */
+            if (coro_yielding_active() <= 0)
+                thrd_yield();
         } else {
             break;
         }
@@ -2173,6 +3182,7 @@ static void_t coro_thread_main(void_t args) {
 static void coro_cleanup(void) {
     if (coro()->is_main) {
         atomic_flag_test_and_set(&gq_result.is_finish);
+        coro_unpark();
         if (!can_cleanup)
             return;
 
@@ -2183,7 +3193,7 @@ static void coro_cleanup(void) {
                 thrd_yield();
 
         if (!is_empty(coro()->sleep_handle) && coro()->sleep_handle->magic_number == CORO_MAGIC_NUMBER) {
-            free(coro()->sleep_handle);
+            coro_stack_free(coro()->sleep_handle);
             coro()->sleep_handle = nullptr;
         }
 
@@ -2193,7 +3203,933 @@ static void coro_cleanup(void) {
         channel_destroy();
         coro_destroy();
         deque_destroy();
+        coro_timeout_free();
+        coro_reactor_free();
+        coro_stack_pool_trim(0);
+    }
+}
+
+/* Number of coroutines parked in calling thread's reactor. */
+static RAII_INLINE u32 coro_io_waiting(void) {
+#if defined(CORO_REACTOR)
+    return coro()->io_waiting;
+#else
+    return 0;
+#endif
+}
+
+#if defined(CORO_REACTOR)
+static int coro_reactor_init(void) {
+    struct epoll_event ev;
+
+    if ((coro()->io_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        return RAII_ERR;
+
+    if (coro_parking.io_wake >= 0) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = coro_parking.io_wake;
+        epoll_ctl(coro()->io_fd, EPOLL_CTL_ADD, coro_parking.io_wake, &ev);
+    }
+
+    return 0;
+}
+
+static void coro_reactor_free(void) {
+#if defined(CORO_URING)
+    coro_ring_free();
+#endif
+    if (coro()->io_fd >= 0) {
+        close(coro()->io_fd);
+        coro()->io_fd = -1;
+    }
+
+    if (!is_empty(coro()->io_table)) {
+        free(coro()->io_table);
+        coro()->io_table = nullptr;
+        coro()->io_capacity = 0;
+    }
+
+    coro()->io_waiting = 0;
+}
+
+/* Edge triggered, every write is seen by all reactors, any of them drains it. */
+static RAII_INLINE void coro_reactor_wake(void) {
+    uint64_t one = 1;
+    if (coro_parking.io_wake >= 0 && write(coro_parking.io_wake, &one, sizeof(one)) < 0)
+        errno = 0;
+}
+
+static RAII_INLINE void coro_io_ready(routine_t *t) {
+    coro()->io_waiting--;
+    t->io_active = false;
+    if (!t->halt)
+        coro_enqueue(t);
+}
+
+/* Remove `t` from it's fd slot, and resume it with `ECANCELED`, on owning thread. */
+static void coro_io_drop(routine_t *t) {
+    coro_io_t *io = &coro()->io_table[t->io_wait_fd];
+
+    if (io->reader == t)
+        io->reader = nullptr;
+    else if (io->writer == t)
+        io->writer = nullptr;
+
+    coro()->io_waiting--;
+    t->io_active = false;
+    t->io_cancelled = true;
+    coro_enqueue(t);
+}
+
+/* Cancel fd wait of `t`, other threads only flag it, and wake reactors,
+it's owner drops the wait on next poll. */
+static void coro_io_cancel(routine_t *t) {
+    raii_deque_t *queue;
+
+    if (t->io_wait_fd < 0)
+        return;
+
+    if (!coro_is_threading() || t->tid == coro()->thrd_id) {
+        coro_io_drop(t);
+    } else if (!atomic_flag_test_and_set(&t->io_cancel)) {
+        queue = gq_result.queue->local[t->tid];
+        atomic_fetch_add(&queue->io_cancels, 1);
+        coro_unpark();
+        coro_reactor_wake();
+    }
+}
+
+/* Drop fd waits other threads flagged cancelled. */
+static void coro_io_cancels(void) {
+    coro_io_t *io;
+    routine_t *t;
+    u32 fd;
+
+    if (!coro_is_threading()
+        || atomic_load_explicit(&gq_result.queue->local[coro()->thrd_id]->io_cancels, memory_order_relaxed) == 0)
+        return;
+
+    atomic_store(&gq_result.queue->local[coro()->thrd_id]->io_cancels, 0);
+    for (fd = 0; fd < coro()->io_capacity; fd++) {
+        io = &coro()->io_table[fd];
+        if (!is_empty(t = io->reader) && atomic_flag_load(&t->io_cancel))
+            coro_io_drop(t);
+
+        if (!is_empty(t = io->writer) && atomic_flag_load(&t->io_cancel))
+            coro_io_drop(t);
+    }
+}
+
+/* Wait `timeout` milliseconds for readiness, and resume every coroutine
+of the batch at once, `0` polls without blocking. */
+static int coro_reactor_poll(int timeout) {
+    struct epoll_event *ev = coro()->io_events;
+    coro_io_t *io;
+    routine_t *t;
+    uint64_t wakes;
+    int i, n;
+
+#if defined(CORO_URING)
+    /* submit file requests queued since last poll, as one batch */
+    if (coro()->ring->queued > 0 && coro_ring_flush() > 0)
+        timeout = 0;
+#endif
+
+    n = epoll_wait(coro()->io_fd, ev, CORO_REACTOR_EVENTS, timeout);
+    for (i = 0; i < n; i++) {
+        if (ev[i].data.fd == coro_parking.io_wake) {
+            /* reset counter before it can saturate, next write is still an edge for all */
+            if (read(coro_parking.io_wake, &wakes, sizeof(wakes)) < 0)
+                errno = 0;
+            continue;
+        } else if ((u32)ev[i].data.fd >= coro()->io_capacity) {
+            continue;
+        }
+
+        io = &coro()->io_table[ev[i].data.fd];
+        if (!is_empty(t = io->reader) && (ev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+            io->reader = nullptr;
+            coro_io_ready(t);
+        }
+
+        if (!is_empty(t = io->writer) && (ev[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+            io->writer = nullptr;
+            coro_io_ready(t);
+        }
+    }
+
+    coro_io_cancels();
+    coro_fs_reap();
+    return n;
+}
+
+/* Park current coroutine until `fd` is readable, or writable.
+
+The fd is registered edge triggered, rearmed by `EPOLL_CTL_MOD` on every wait,
+which also reports readiness that happened before, no wakeup can be lost,
+even after the fd number is closed and reused. */
+static int coro_io_wait(int fd, bool writing) {
+    struct epoll_event ev;
+    routine_t *co = coro()->running, **slot;
+    u32 capacity;
+
+    if (is_empty(co))
+        return 0;
+
+    if (fd < 0) {
+        errno = EBADF;
+        return RAII_ERR;
+    }
+
+    if (coro()->io_fd < 0 && coro_reactor_init() < 0)
+        return RAII_ERR;
+
+    if ((u32)fd >= coro()->io_capacity) {
+        capacity = coro()->io_capacity ? coro()->io_capacity : 64;
+        while (capacity <= (u32)fd)
+            capacity *= 2;
+
+        coro()->io_table = try_realloc(coro()->io_table, capacity * sizeof(coro_io_t));
+        memset(coro()->io_table + coro()->io_capacity, 0, (capacity - coro()->io_capacity) * sizeof(coro_io_t));
+        coro()->io_capacity = capacity;
+    }
+
+    slot = writing ? &coro()->io_table[fd].writer : &coro()->io_table[fd].reader;
+    if (!is_empty(*slot)) {
+        /* only one reader, and one writer, per fd */
+        errno = EBUSY;
+        return RAII_ERR;
+    }
+
+    *slot = co;
+    ev.events = EPOLLET | EPOLLRDHUP
+        | (coro()->io_table[fd].reader ? EPOLLIN : 0)
+        | (coro()->io_table[fd].writer ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if (epoll_ctl(coro()->io_fd, EPOLL_CTL_MOD, fd, &ev) < 0
+        && (errno != ENOENT || epoll_ctl(coro()->io_fd, EPOLL_CTL_ADD, fd, &ev) < 0)) {
+        *slot = nullptr;
+        /* regular files, can't be polled, are always ready */
+        return errno == EPERM ? 0 : RAII_ERR;
+    }
+
+    /* an cancel flagged for an earlier wait, not this one */
+    atomic_flag_clear(&co->io_cancel);
+    co->io_wait_fd = fd;
+    co->io_active = true;
+    coro()->io_waiting++;
+    coro_suspend();
+    co->io_wait_fd = RAII_ERR;
+    if (co->io_cancelled) {
+        co->io_cancelled = false;
+        errno = ECANCELED;
+        return RAII_ERR;
+    }
+
+    return 0;
+}
+#else
+static RAII_INLINE void coro_reactor_free(void) {
+}
+
+static RAII_INLINE void coro_reactor_wake(void) {
+}
+
+static RAII_INLINE int coro_reactor_poll(int timeout) {
+    return RAII_ERR;
+}
+
+static RAII_INLINE void coro_io_cancel(routine_t *t) {
+}
+
+/* No reactor, let other coroutines run until `fd` is ready. */
+static int coro_io_wait(int fd, bool writing) {
+#if !defined(_WIN32)
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = writing ? POLLOUT : POLLIN;
+    while (!is_empty(coro()->running) && poll(&pfd, 1, 0) == 0)
+        yield();
+#endif
+
+    return 0;
+}
+#endif
+
+#if !defined(_WIN32)
+static RAII_INLINE bool coro_io_again(void) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+ssize_t coro_read(int fd, void_t buf, size_t n) {
+    ssize_t r;
+
+    while ((r = read(fd, buf, n)) < 0 && coro_io_again()) {
+        if (errno != EINTR && coro_io_wait(fd, false) < 0)
+            break;
+    }
+
+    return r;
+}
+
+ssize_t coro_write(int fd, const void_t buf, size_t n) {
+    size_t written = 0;
+    ssize_t r;
+
+    while (written < n) {
+        if ((r = write(fd, (const char *)buf + written, n - written)) >= 0) {
+            written += r;
+        } else if (!coro_io_again() || (errno != EINTR && coro_io_wait(fd, true) < 0)) {
+            return written ? (ssize_t)written : RAII_ERR;
+        }
+    }
+
+    return (ssize_t)written;
+}
+
+int coro_accept(int fd, struct sockaddr *addr, socklen_t *addrlen) {
+    int client;
+
+    for (;;) {
+#if defined(__linux__)
+        client = accept4(fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        if ((client = accept(fd, addr, addrlen)) >= 0)
+            fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        if (client >= 0 || !coro_io_again()
+            || (errno != EINTR && coro_io_wait(fd, false) < 0))
+            return client;
+    }
+}
+
+int coro_connect(int fd, const struct sockaddr *addr, socklen_t addrlen) {
+    socklen_t len = sizeof(int);
+    int err = 0;
+
+    if (connect(fd, addr, addrlen) == 0)
+        return 0;
+
+    if (errno != EINPROGRESS && errno != EINTR)
+        return RAII_ERR;
+
+    if (coro_io_wait(fd, true) < 0
+        || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        return RAII_ERR;
+
+    if (err) {
+        errno = err;
+        return RAII_ERR;
+    }
+
+    return 0;
+}
+
+int coro_nonblock(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? RAII_ERR : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+#endif
+
+#if !defined(_WIN32)
+enum {
+    CORO_FS_OPEN,
+    CORO_FS_READ,
+    CORO_FS_WRITE,
+    CORO_FS_FSYNC,
+    CORO_FS_STAT,
+    CORO_FS_FSTAT,
+    CORO_FS_CLOSE
+};
+
+/* File request, lives on the stack of parked coroutine. */
+struct coro_fs_s {
+    int op;
+    int fd;
+    int flags;
+    u32 mode;
+    i64 offset;
+    size_t length;
+    void_t buf;
+    string_t path;
+    struct stat *st;
+#if defined(CORO_URING)
+    struct statx stx[1];
+#endif
+    /* result, or `-errno` */
+    ssize_t result;
+    routine_t *co;
+    /* pushed onto `fs_done` of thread that parked `co` */
+    atomic_fs_t *done;
+    coro_fs_t *next;
+};
+
+/* Execute request with blocking system calls. */
+static void coro_fs_run(coro_fs_t *req) {
+    ssize_t r;
+
+    switch (req->op) {
+        case CORO_FS_OPEN:
+            r = open(req->path, req->flags, (mode_t)req->mode);
+            break;
+        case CORO_FS_READ:
+            r = req->offset < 0
+                ? read(req->fd, req->buf, req->length)
+                : pread(req->fd, req->buf, req->length, (off_t)req->offset);
+            break;
+        case CORO_FS_WRITE:
+            r = req->offset < 0
+                ? write(req->fd, req->buf, req->length)
+                : pwrite(req->fd, req->buf, req->length, (off_t)req->offset);
+            break;
+        case CORO_FS_FSYNC:
+            r = fsync(req->fd);
+            break;
+        case CORO_FS_STAT:
+            r = stat(req->path, req->st);
+            break;
+        case CORO_FS_FSTAT:
+            r = fstat(req->fd, req->st);
+            break;
+        case CORO_FS_CLOSE:
+            r = close(req->fd);
+            break;
+        default:
+            r = RAII_ERR;
+            errno = EINVAL;
+    }
+
+    req->result = r < 0 ? -errno : r;
+}
+#endif
+
+#if defined(CORO_REACTOR)
+/* Blocking offload threads, for kernels without `io_uring`. */
+static struct {
+    u32 count;
+    bool shutdown;
+    coro_fs_t *head;
+    coro_fs_t *tail;
+    mtx_t lock;
+    cnd_t wake;
+    thrd_t threads[CORO_FS_THREADS];
+} coro_fs_pool;
+
+static int coro_fs_worker(void_t arg) {
+    coro_fs_t *req, *head;
+    (void)arg;
+
+    for (;;) {
+        mtx_lock(&coro_fs_pool.lock);
+        while (is_empty(req = coro_fs_pool.head) && !coro_fs_pool.shutdown)
+            cnd_wait(&coro_fs_pool.wake, &coro_fs_pool.lock);
+
+        if (is_empty(req)) {
+            mtx_unlock(&coro_fs_pool.lock);
+            break;
+        }
+
+        if (is_empty(coro_fs_pool.head = req->next))
+            coro_fs_pool.tail = nullptr;
+        mtx_unlock(&coro_fs_pool.lock);
+
+        coro_fs_run(req);
+        do {
+            head = (coro_fs_t *)atomic_load(req->done);
+            req->next = head;
+        } while (!atomic_compare_exchange_weak(req->done, &head, req));
+
+        coro_reactor_wake();
+    }
+
+    return 0;
+}
+
+static void coro_fs_offload(coro_fs_t *req) {
+    req->next = nullptr;
+    req->done = &coro()->fs_done;
+    mtx_lock(&coro_fs_pool.lock);
+    if (coro_fs_pool.count < CORO_FS_THREADS
+        && thrd_create(&coro_fs_pool.threads[coro_fs_pool.count], coro_fs_worker, nullptr) == thrd_success)
+        coro_fs_pool.count++;
+
+    if (is_empty(coro_fs_pool.tail))
+        coro_fs_pool.head = req;
+    else
+        coro_fs_pool.tail->next = req;
+
+    coro_fs_pool.tail = req;
+    cnd_signal(&coro_fs_pool.wake);
+    mtx_unlock(&coro_fs_pool.lock);
+}
+
+/* Signal offload threads to exit once queue is drained, and join them. */
+static void coro_fs_shutdown(void) {
+    u32 i, count;
+
+    mtx_lock(&coro_fs_pool.lock);
+    count = coro_fs_pool.count;
+    coro_fs_pool.shutdown = true;
+    cnd_broadcast(&coro_fs_pool.wake);
+    mtx_unlock(&coro_fs_pool.lock);
+    for (i = 0; i < count; i++) {
+        if (atomic_flag_load(&gq_result.is_errorless))
+            thrd_join(coro_fs_pool.threads[i], nullptr);
+        else
+            thrd_detach(coro_fs_pool.threads[i]);
+    }
+
+    mtx_lock(&coro_fs_pool.lock);
+    coro_fs_pool.count = 0;
+    coro_fs_pool.shutdown = false;
+    mtx_unlock(&coro_fs_pool.lock);
+}
+#else
+static void coro_fs_shutdown(void) {
+}
+#endif
+
+#if defined(CORO_URING)
+static bool coro_ring_disabled = false;
+/* Requests by `CORO_FS_*` op, kernel's `io_uring` supports, others are offloaded. */
+static bool coro_ring_ops[CORO_FS_CLOSE + 1] = {0};
+
+/* Ask kernel which opcodes ring `fd` supports, returns how many `CORO_FS_*` ops it can take. */
+static int coro_ring_probe(int fd) {
+    static const u8 opcodes[CORO_FS_CLOSE + 1] = {
+        IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC,
+        IORING_OP_STATX, IORING_OP_STATX, IORING_OP_CLOSE
+    };
+    struct io_uring_probe *probe = try_calloc(1, sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+    int i, count = 0;
+
+    /* before kernel 5.6 there is no probe, nor any of these opcodes except fsync */
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        for (i = 0; i <= CORO_FS_CLOSE; i++) {
+            coro_ring_ops[i] = opcodes[i] <= probe->last_op
+                && (probe->ops[opcodes[i]].flags & IO_URING_OP_SUPPORTED);
+            count += coro_ring_ops[i];
+        }
+    }
+
+    free(probe);
+    return count;
+}
+
+static int coro_ring_init(coro_ring_t *r) {
+    struct io_uring_params p;
+    struct epoll_event ev;
+    u8 *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    if ((r->fd = (int)syscall(__NR_io_uring_setup, CORO_RING_ENTRIES, &p)) < 0) {
+        /* not supported by kernel, or disabled, use offload threads from now on */
+        coro_ring_disabled = true;
+        return RAII_ERR;
+    }
+
+    if (coro_ring_probe(r->fd) == 0) {
+        close(r->fd);
+        r->fd = -1;
+        coro_ring_disabled = true;
+        return RAII_ERR;
+    }
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(u32);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->sq_size = r->cq_size = r->sq_size > r->cq_size ? r->sq_size : r->cq_size;
+
+    r->sq_ptr = mmap(nullptr, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq_ptr = (p.features & IORING_FEAT_SINGLE_MMAP) ? r->sq_ptr
+        : mmap(nullptr, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes = mmap(nullptr, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sq_ptr == MAP_FAILED || r->cq_ptr == MAP_FAILED || r->sqes == MAP_FAILED) {
+        RAII_LOG("Error: `io_uring` mmap");
+        close(r->fd);
+        r->fd = -1;
+        coro_ring_disabled = true;
+        return RAII_ERR;
+    }
+
+    sq = (u8 *)r->sq_ptr;
+    cq = (u8 *)r->cq_ptr;
+    r->entries = p.sq_entries;
+    r->sq_head = (u32 *)(sq + p.sq_off.head);
+    r->sq_tail = (u32 *)(sq + p.sq_off.tail);
+    r->sq_mask = (u32 *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (u32 *)(sq + p.sq_off.array);
+    r->cq_head = (u32 *)(cq + p.cq_off.head);
+    r->cq_tail = (u32 *)(cq + p.cq_off.tail);
+    r->cq_mask = (u32 *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->queued = r->inflight = 0;
+
+    /* ring fd turns readable with completions, wakes parked reactor */
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = r->fd;
+    epoll_ctl(coro()->io_fd, EPOLL_CTL_ADD, r->fd, &ev);
+
+    return 0;
+}
+
+static void coro_ring_free(void) {
+    coro_ring_t *r = coro()->ring;
+    if (r->fd >= 0) {
+        munmap(r->sqes, r->entries * sizeof(struct io_uring_sqe));
+        if (r->cq_ptr != r->sq_ptr)
+            munmap(r->cq_ptr, r->cq_size);
+
+        munmap(r->sq_ptr, r->sq_size);
+        close(r->fd);
+        r->fd = -1;
+    }
+}
+
+/* Submit all queued SQEs with one `io_uring_enter`, returns completions ready. */
+static int coro_ring_flush(void) {
+    coro_ring_t *r = coro()->ring;
+    int submitted;
+
+    atomic_thread_fence(memory_order_release);
+    if ((submitted = (int)syscall(__NR_io_uring_enter, r->fd, r->queued, 0, 0, nullptr, 0)) > 0) {
+        r->queued -= submitted;
+        r->inflight += submitted;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    return (int)(*r->cq_tail - *r->cq_head);
+}
+
+/* Fill in next SQE for `req`, submitted with the next reactor poll. */
+static void coro_ring_queue(coro_ring_t *r, coro_fs_t *req) {
+    struct io_uring_sqe *sqe;
+    u32 tail = *r->sq_tail, index;
+
+    if (tail - *r->sq_head >= r->entries) {
+        coro_ring_flush();
+        tail = *r->sq_tail;
+    }
+
+    index = tail & *r->sq_mask;
+    sqe = &r->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = req->fd;
+    sqe->user_data = (u64)(uintptr_t)req;
+    switch (req->op) {
+        case CORO_FS_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (u64)(uintptr_t)req->path;
+            sqe->len = req->mode;
+            sqe->open_flags = (u32)req->flags;
+            break;
+        case CORO_FS_READ:
+        case CORO_FS_WRITE:
+            sqe->opcode = req->op == CORO_FS_READ ? IORING_OP_READ : IORING_OP_WRITE;
+            sqe->addr = (u64)(uintptr_t)req->buf;
+            sqe->len = (u32)req->length;
+            /* `-1` uses and moves current file position */
+            sqe->off = req->offset < 0 ? (u64)-1 : (u64)req->offset;
+            break;
+        case CORO_FS_FSYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        case CORO_FS_STAT:
+        case CORO_FS_FSTAT:
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = req->op == CORO_FS_STAT ? AT_FDCWD : req->fd;
+            sqe->addr = (u64)(uintptr_t)(req->op == CORO_FS_STAT ? req->path : "");
+            sqe->len = STATX_BASIC_STATS;
+            sqe->off = (u64)(uintptr_t)req->stx;
+            sqe->statx_flags = req->op == CORO_FS_STAT ? 0 : AT_EMPTY_PATH;
+            break;
+        case CORO_FS_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            break;
+    }
+
+    r->sq_array[index] = index;
+    atomic_thread_fence(memory_order_release);
+    *r->sq_tail = tail + 1;
+    r->queued++;
+}
+
+static void coro_fs_statx(coro_fs_t *req) {
+    struct stat *st = req->st;
+    struct statx *stx = req->stx;
+
+    memset(st, 0, sizeof(*st));
+    st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    st->st_ino = stx->stx_ino;
+    st->st_mode = stx->stx_mode;
+    st->st_nlink = stx->stx_nlink;
+    st->st_uid = stx->stx_uid;
+    st->st_gid = stx->stx_gid;
+    st->st_rdev = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+    st->st_size = stx->stx_size;
+    st->st_blksize = stx->stx_blksize;
+    st->st_blocks = stx->stx_blocks;
+    st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+    st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+    st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+#endif
+
+#if defined(CORO_REACTOR)
+/* Resume coroutines of completed file requests, from ring and offload threads. */
+static void coro_fs_reap(void) {
+    coro_fs_t *req, *next;
+#if defined(CORO_URING)
+    coro_ring_t *r = coro()->ring;
+    struct io_uring_cqe *cqe;
+    u32 head, tail;
+
+    if (r->fd >= 0 && r->inflight > 0) {
+        head = *r->cq_head;
+        atomic_thread_fence(memory_order_acquire);
+        tail = *r->cq_tail;
+        for (; head != tail; head++) {
+            cqe = &r->cqes[head & *r->cq_mask];
+            req = (coro_fs_t *)(uintptr_t)cqe->user_data;
+            req->result = cqe->res;
+            if (req->result >= 0 && (req->op == CORO_FS_STAT || req->op == CORO_FS_FSTAT))
+                coro_fs_statx(req);
+
+            r->inflight--;
+            coro_io_ready(req->co);
+        }
+
+        atomic_thread_fence(memory_order_release);
+        *r->cq_head = head;
+    }
+#endif
+
+    if (!is_empty(atomic_load_explicit(&coro()->fs_done, memory_order_relaxed))) {
+        for (req = (coro_fs_t *)atomic_exchange(&coro()->fs_done, nullptr); !is_empty(req); req = next) {
+            next = req->next;
+            coro_io_ready(req->co);
+        }
+    }
+}
+#else
+static RAII_INLINE void coro_fs_reap(void) {
+}
+#endif
+
+#if !defined(_WIN32)
+/* Run request, parking current coroutine until it completes. */
+static ssize_t coro_fs_submit(coro_fs_t *req) {
+    routine_t *co = coro()->running;
+
+    req->co = co;
+#if defined(CORO_REACTOR)
+    if (!is_empty(co) && (coro()->io_fd >= 0 || coro_reactor_init() == 0)) {
+#if defined(CORO_URING)
+        if (!coro_ring_disabled && (coro()->ring->fd >= 0 || coro_ring_init(coro()->ring) == 0)
+            && coro_ring_ops[req->op])
+            coro_ring_queue(coro()->ring, req);
+        else
+#endif
+            coro_fs_offload(req);
+
+        co->io_active = true;
+        coro()->io_waiting++;
+        coro_suspend();
+    } else
+#endif
+    {
+        coro_fs_run(req);
+    }
+
+    if (req->result < 0) {
+        errno = (int)-req->result;
+        return RAII_ERR;
+    }
+
+    return req->result;
+}
+
+static RAII_INLINE void coro_fs_init(coro_fs_t *req, int op, int fd) {
+    memset(req, 0, sizeof(coro_fs_t));
+    req->op = op;
+    req->fd = fd;
+    req->offset = -1;
+}
+
+int coro_fs_open(string_t path, int flags, u32 mode) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_OPEN, -1);
+    req.path = path;
+    req.flags = flags | O_CLOEXEC;
+    req.mode = mode;
+
+    return (int)coro_fs_submit(&req);
+}
+
+ssize_t coro_fs_read(int fd, void_t buf, size_t n, i64 offset) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_READ, fd);
+    req.buf = buf;
+    req.length = n;
+    req.offset = offset;
+
+    return coro_fs_submit(&req);
+}
+
+ssize_t coro_fs_write(int fd, const void_t buf, size_t n, i64 offset) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_WRITE, fd);
+    req.buf = (void_t)buf;
+    req.length = n;
+    req.offset = offset;
+
+    return coro_fs_submit(&req);
+}
+
+int coro_fs_fsync(int fd) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_FSYNC, fd);
+
+    return (int)coro_fs_submit(&req);
+}
+
+int coro_fs_stat(string_t path, struct stat *st) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_STAT, -1);
+    req.path = path;
+    req.st = st;
+
+    return (int)coro_fs_submit(&req);
+}
+
+int coro_fs_fstat(int fd, struct stat *st) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_FSTAT, fd);
+    req.st = st;
+
+    return (int)coro_fs_submit(&req);
+}
+
+int coro_fs_close(int fd) {
+    coro_fs_t req;
+    coro_fs_init(&req, CORO_FS_CLOSE, fd);
+
+    return (int)coro_fs_submit(&req);
+}
+#endif
+
+/* Wake all parked scheduler threads, only takes lock if any are parked. */
+static void coro_unpark(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&coro_parking.waiters) > 0) {
+        mtx_lock(&coro_parking.lock);
+        atomic_fetch_add(&coro_parking.epoch, 1);
+        cnd_broadcast(&coro_parking.wake);
+        mtx_unlock(&coro_parking.lock);
+        coro_reactor_wake();
+    }
+}
+
+/* Park calling thread until `ready()`, an `coro_unpark`, or `timeout` nanoseconds passes.
+Will spin `CORO_PARK_SPIN` times first, parking is capped at `CORO_PARK_TIMEOUT`. */
+static void coro_park_wait(bool (*ready)(void), size_t timeout) {
+    struct timespec ts;
+    struct timeval tv;
+    size_t key;
+    u32 i;
+
+    for (i = 0; i < CORO_PARK_SPIN; i++) {
+        if (ready())
+            return;
+
+        thrd_yield();
+    }
+
+    if (timeout == 0 || timeout > (size_t)CORO_PARK_TIMEOUT * 1000000)
+        timeout = (size_t)CORO_PARK_TIMEOUT * 1000000;
+
+    /* Register as waiter before final `ready()` check, any `coro_unpark`
+    after that check will see waiter and bump `epoch`. */
+    atomic_fetch_add(&coro_parking.waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    key = atomic_load(&coro_parking.epoch);
+    if (coro_io_waiting()) {
+        /* coroutines are waiting on fds, park in reactor instead */
+        if (!ready())
+            coro_reactor_poll((int)((timeout + 999999) / 1000000));
+    } else if (!ready()) {
+        gettimeofday(&tv, nullptr);
+        ts.tv_sec = tv.tv_sec + timeout / 1000000000;
+        ts.tv_nsec = tv.tv_usec * 1000 + timeout % 1000000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        mtx_lock(&coro_parking.lock);
+        while (atomic_load(&coro_parking.epoch) == key) {
+            if (cnd_timedwait(&coro_parking.wake, &coro_parking.lock, &ts) != thrd_success)
+                break;
+        }
+        mtx_unlock(&coro_parking.lock);
     }
+
+    atomic_fetch_sub(&coro_parking.waiters, 1);
+}
+
+/* Time spent in `coro_park_wait` is counted as thread's idle time. */
+static void coro_park(bool (*ready)(void), size_t timeout) {
+    coro_counters_t *counters = coro_counters();
+    size_t start = get_timer();
+
+    atomic_store_explicit(&counters->parked, start, memory_order_relaxed);
+    coro_park_wait(ready, timeout);
+    atomic_store_explicit(&counters->parked, 0, memory_order_relaxed);
+    coro_count(&counters->idle_ns, get_timer() - start);
+}
+
+/* Check for work in current thread's `local` run queue, or shutdown. */
+static bool coro_park_local(void) {
+    raii_deque_t *queue;
+    return !raii_is_running() || (coro_is_threading()
+        && (atomic_load(&(queue = gq_result.queue->local[coro()->thrd_id])->available) > 0
+            || !is_empty(atomic_load_explicit(&queue->inbox, memory_order_relaxed))
+            || atomic_load_explicit(&queue->io_cancels, memory_order_relaxed) > 0));
+}
+
+/* Check for work in any thread's `local` run queue, or shutdown. */
+static bool coro_park_any(void) {
+    u32 i;
+    if (coro_park_local())
+        return true;
+
+    for (i = 0; i < gq_result.thread_count; i++) {
+        if (atomic_load(&gq_result.queue->local[i]->available) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+static bool coro_park_shutdown(void) {
+    return !raii_is_running()
+        || atomic_flag_load(&gq_result.queue->local[coro()->thrd_id]->shutdown);
+}
+
+/* Workers are created before `gq_result.queue` is set, check it first. */
+static bool coro_park_started(void) {
+    return atomic_flag_load(&gq_result.is_started)
+        || (!is_empty(gq_result.queue) && coro_park_shutdown());
+}
+
+/* Check for shutdown, or new work for an worker waiting to exit. */
+static bool coro_park_idle(void) {
+    return coro_park_shutdown() || coro_park_local();
 }
 
 /* Simple random number generated (like rand) using the given seed. */
@@ -2205,46 +4141,139 @@ static RAII_INLINE u32 rng(u32 *seed, int max) {
 
     *seed = next;
 
-    return next % max;
+    /* low bits of this generator cycle quickly, use the high ones. */
+    return (next >> 16) % max;
+}
+
+/* Check coroutine can run on any thread, excluding system, ~thread~ main,
+legacy `waitgroup` members, and those waiting or flagged. */
+static bool coro_is_stealable(routine_t *t) {
+    return !t->system && !t->event_system && !t->wait_active && !t->flagged
+        && t->run_code != CORO_RUN_THRD && t->run_code != CORO_RUN_MAIN
+        && !(t->is_group && is_empty(t->group));
+}
+
+/* Move stolen coroutine `t` count from `victim` to current thread,
+`victim` settles it's own `used_count` on next `coro_take`. */
+static void coro_steal_account(raii_deque_t *victim, raii_deque_t *local, routine_t *t) {
+    atomic_fetch_sub(&victim->available, 1);
+    atomic_fetch_add(&victim->steal_count, 1);
+    atomic_fetch_add(&local->steal_taken, 1);
+    if (t->taken)
+        atomic_fetch_add(&victim->steal_given, 1);
+    else
+        t->taken = true;
+
+    coro()->used_count++;
+    coro()->stolen_count++;
+    t->tid = coro()->thrd_id;
 }
 
 /**
- * (Try to) steal and execute a task from a random worker.
+ * (Try to) steal half the tasks of a worker, visiting every other worker once,
+ * starting from a random one. Returns first task stolen to execute,
+ * any others go into current thread's `deque`, where they can be stolen again.
  */
 static routine_t *deque_random_steal(void) {
-    routine_t *t = RAII_EMPTY_T;
-    if (coro_sched_is_stealable()) {
-        u32 i, victim = (coro()->thrd_id + 1 + rng(&coro()->seed, gq_result.thread_count - 1)) % gq_result.thread_count;
-        for (i = victim; i < gq_result.thread_count; i++) {
-            if (i == coro()->thrd_id) {
+    routine_t *t, *first = RAII_EMPTY_T;
+    raii_deque_t *victim, *local;
+    size_t i, half;
+    u32 n, id, count = gq_result.thread_count;
+
+    if (count < 2 || !coro_sched_is_stealable())
+        return first;
+
+    local = gq_result.queue->local[coro()->thrd_id];
+    atomic_fetch_add(&local->steal_attempts, 1);
+    id = rng(&coro()->seed, count);
+    for (n = 0; n < count && first == RAII_EMPTY_T; n++, id = (id + 1) % count) {
+        if (id == coro()->thrd_id)
+            continue;
+
+        victim = gq_result.queue->local[id];
+        if ((half = atomic_load(&victim->available)) == 0)
+            continue;
+
+        half = (half + 1) / 2;
+        for (i = 0; i < half; i++) {
+            t = deque_steal(victim);
+            if (t == RAII_ABORT_T) {
+                --i;
+                continue;
+            } else if (t == RAII_EMPTY_T) {
+                break;
+            } else if (!coro_is_stealable(t)) {
+                /* Only checked once it's ours, back to `victim` bottom, not blocking it's `top`,
+                still counted there, as `available`. */
+                deque_push(victim, t);
                 continue;
             }
 
-            raii_deque_t *queue = gq_result.queue->local[i];
-            if (atomic_load(&queue->available) > 1) {
-                t = deque_take(queue);
-                if (t == RAII_EMPTY_T)
-                    continue;
-
-                atomic_fetch_sub(&queue->available, 1);
-                if (t->system || t->is_group || t->run_code == CORO_RUN_THRD) {
-                    coro_enqueue(t);
-                    t = RAII_EMPTY_T;
-                    continue;
-                }
-
-                atomic_fetch_add(&queue->steal_count, 1);
-                coro()->stolen_count++;
-                t->tid = coro()->thrd_id;
-                break;
+            coro_steal_account(victim, local, t);
+            coro_traced(CORO_TRACE_STEAL, t->cid, id);
+            if (first == RAII_EMPTY_T) {
+                first = t;
+            } else {
+                deque_push(local, t);
+                atomic_fetch_add(&local->available, 1);
             }
         }
     }
 
-    return t;
+    if (first == RAII_EMPTY_T)
+        atomic_fetch_add(&local->steal_failures, 1);
+
+    return first;
+}
+
+/* Back off after failed steal round, yielding doubling times for first `CORO_STEAL_BACKOFF` rounds,
+then parking until any work, and finally until only own work, or timeout. */
+static void coro_steal_backoff(void) {
+    u32 i, rounds = ++coro()->steal_backoff;
+    if (rounds <= CORO_STEAL_BACKOFF) {
+        for (i = 0; i < (1u << rounds); i++)
+            thrd_yield();
+    } else if (rounds <= CORO_STEAL_BACKOFF * 2) {
+        coro_park(coro_park_any, 0);
+    } else {
+        /* Others may hold only coroutines that can't be stolen, don't keep waking for them. */
+        coro_park(coro_park_local, 0);
+        coro()->steal_backoff = CORO_STEAL_BACKOFF;
+    }
+}
+
+steal_stats_t coro_steal_stats(u32 thrd_id) {
+    steal_stats_t stats;
+    raii_deque_t *queue;
+
+    memset(&stats, 0, sizeof(stats));
+    if (coro_is_threading() && thrd_id < gq_result.thread_count) {
+        queue = gq_result.queue->local[thrd_id];
+        stats.stolen = atomic_load(&queue->steal_taken);
+        stats.lost = atomic_load(&queue->steal_count);
+        stats.attempts = atomic_load(&queue->steal_attempts);
+        stats.failures = atomic_load(&queue->steal_failures);
+    }
+
+    return stats;
+}
+
+/* Profile, and trace, run slice of `t` that began at `started`, minus `idle` time parked. */
+static void coro_switch_timed(routine_t *t, size_t started, size_t idle) {
+    size_t now = get_timer();
+
+    if (atomic_flag_load_explicit(&coro_profiler.enabled, memory_order_relaxed))
+        coro_profile_slice(t, now - started - idle);
+
+    if (atomic_flag_load_explicit(&coro_tracer.enabled, memory_order_relaxed))
+        coro_trace_put(CORO_TRACE_SWITCH, t->cid, 0, started, now - started);
 }
 
 static int scheduler(void) {
+    raii_deque_t *queue;
+    bool released;
+    coro_counters_t *counters;
+    size_t started, idle;
     routine_t *t = nullptr;
     bool stole, have_work = false;
 
@@ -2253,10 +4282,19 @@ static int scheduler(void) {
         /* Don't take on thread first launch/startup, only afterwards. */
         if (((coro()->is_main && atomic_flag_load_explicit(&gq_result.is_started, memory_order_relaxed))
              || (!coro()->is_main && coro()->started)) && coro_is_threading()) {
-            if (have_work = coro_take(gq_result.queue->local[coro()->thrd_id], false))
+            queue = gq_result.queue->local[coro()->thrd_id];
+            /* Take all of an posted `waitgroup`, even with no coroutine left to call `coro_stealer`. */
+            if (have_work = coro_take(queue, gq_result.is_takeable
+                                      && atomic_flag_load(&gq_result.is_waitable)
+                                      && !atomic_flag_load(&queue->taken)))
                 t = nullptr;
         }
 
+        /* Coroutines woken by other threads, before deciding this thread is idle. */
+        if (coro_is_threading()
+            && !is_empty(atomic_load_explicit(&gq_result.queue->local[coro()->thrd_id]->inbox, memory_order_relaxed)))
+            coro_inbox_take(gq_result.queue->local[coro()->thrd_id]);
+
         if (coro_sched_empty() || !coro_sched_active() || t == RAII_EMPTY_T || coro()->exiting) {
             if (coro()->is_main && (raii_is_exiting() || coro()->exiting || t == RAII_EMPTY_T
                                     || (coro_queue_is_empty() && coro_sched_empty()))) {
@@ -2271,43 +4309,88 @@ static int scheduler(void) {
             } else if (!coro()->is_main && !coro_sched_active() && t != RAII_EMPTY_T
                        && !atomic_flag_load(&gq_result.is_finish)
                        && !coro_sched_is_sleeping()) {
-        /* TODO: bug fix stealing logic and account for any stolen coroutines back to thread taken from. */
-                if ((t = deque_random_steal()) == RAII_EMPTY_T)
+                if ((t = deque_random_steal()) == RAII_EMPTY_T) {
+                    coro_steal_backoff();
                     continue;
+                }
 
+                coro()->steal_backoff = 0;
                 stole = true;
             } else if (!coro()->is_main && (coro_sched_empty() || raii_is_exiting())) {
-                if (coro_is_threading() && coro_queue_active_count() > 0)
+                released = coro_is_threading() && coro_queue_active_count() > 0;
+                if (released)
                     atomic_fetch_sub(&gq_result.active_count, 1);
                 RAII_INFO("Thrd #%zx waiting to exit."CLR_LN, thrd_self());
 				/* Wait for global exit signal */
 				if (!atomic_flag_load(&gq_result.is_disabled))
-					while (raii_is_running()
-						&& !atomic_flag_load(&gq_result.queue->local[coro()->thrd_id]->shutdown))
-						thrd_yield();
+					while (!coro_park_shutdown() && (raii_is_exiting() || !coro_park_local()))
+						coro_park(coro_park_idle, 0);
+
+                /* Coroutines of an later `waitgroup`, or woken ones, arrived while idle. */
+                if (!coro_park_shutdown() && !raii_is_exiting() && coro_park_local()) {
+                    if (released)
+                        atomic_fetch_add(&gq_result.active_count, 1);
+                    continue;
+                }
 
                 RAII_INFO("Thrd #%zx exiting, %d runnable coroutines."CLR_LN, thrd_self(), coro()->used_count);
                 return coro()->exiting;
             }
         }
 
+#if defined(CORO_REACTOR)
+        /* Resume coroutines whose fd became ready, without waiting for an idle thread. */
+        if (coro()->io_waiting > 0 && ++coro()->io_ticks % CORO_REACTOR_TICK == 0)
+            coro_reactor_poll(0);
+#endif
+
         if (!stole) {
             t = coro_dequeue(coro()->run_queue);
-            if (t == nullptr)
+            if (t == nullptr) {
+                coro_stack_pool_trim(CORO_POOL_IDLE);
+                /* nothing runnable, park until an fd is ready, or another thread wakes one */
+                if (coro_io_waiting() || coro_is_threading())
+                    coro_park(coro_park_local, 0);
                 continue;
+            }
         }
 
         t->ready = false;
         coro()->running = t;
-        coro()->num_others_ran++;
+        /* system coroutines always have more to do, don't count as progress */
+        if (!t->system)
+            coro()->num_others_ran++;
         t->cycles++;
+        counters = coro_counters();
+        coro_count(&counters->switches, 1);
+        atomic_store_explicit(&counters->queued, coro()->run_queue->count, memory_order_relaxed);
+        atomic_store_explicit(&counters->sleeping, coro()->sleep_size, memory_order_relaxed);
 
         coro_interrupter();
-        if (!is_status_invalid(t) && !t->halt)
+        if (!is_status_invalid(t) && !t->halt) {
+            preempt_slice(t);
+            started = 0;
+            if (atomic_flag_load_explicit(&coro_profiler.enabled, memory_order_relaxed)
+                || atomic_flag_load_explicit(&coro_tracer.enabled, memory_order_relaxed)) {
+                /* time parked by coroutine itself, like `coro_wait_system`, isn't run time */
+                idle = atomic_load_explicit(&counters->idle_ns, memory_order_relaxed);
+                started = get_timer();
+            }
+
             coro_switch(t);
+            if (started)
+                coro_switch_timed(t, started, atomic_load_explicit(&counters->idle_ns, memory_order_relaxed) - idle);
+            preempt_slice(nullptr);
+        }
 
         coro()->running = nullptr;
+        if (t->requeue) {
+            t->requeue = false;
+            coro_atomic_enqueue(t);
+        }
+
         if (t->halt || t->exiting) {
+            coro_count(&counters->completed, 1);
             if (!t->system && !t->event_system) {
                 --coro()->used_count;
                 if (coro_is_threading() && coro_queue_active_count() > 0)
@@ -2337,11 +4420,151 @@ static int scheduler(void) {
                 coro_delete(t);
             } else if (t->is_referenced) {
                 coro_gc(t);
+            } else if (!is_empty(t->group)) {
+                coro_group_done(t);
             }
         }
     }
 }
 
+void coro_workers(u32 count) {
+    coro_workers_requested = count;
+}
+
+void coro_affinity(coro_affinity_t policy, string_t list) {
+    coro_affinity_requested = true;
+    coro_affinity_policy = policy;
+    snprintf(coro_affinity_list, sizeof(coro_affinity_list), "%s", is_empty((void_t)list) ? "" : list);
+}
+
+int coro_thrd_cpu(u32 thrd_id) {
+    if (coro_is_threading() && thrd_id < gq_result.thread_count)
+        return gq_result.queue->local[thrd_id]->cpu;
+
+    return RAII_ERR;
+}
+
+#if defined(__linux__)
+/* Add cpus, or nodes, of an list like `0-3,8` to `set`. */
+static void coro_cpulist_add(string_t list, cpu_set_t *set) {
+    char *end;
+    long first, last;
+    while (*list) {
+        first = strtol(list, &end, 10);
+        if (end == list)
+            break;
+
+        last = first;
+        if (*end == '-') {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if (end == list)
+                break;
+        }
+
+        for (; first <= last && first < CPU_SETSIZE; first++) {
+            if (first >= 0)
+                CPU_SET(first, set);
+        }
+
+        list = *end == ',' ? end + 1 : end;
+        if (*end != ',')
+            break;
+    }
+}
+
+/* Add cpus of each NUMA node in `set` to `cpus`, as listed by `sysfs`. */
+static void coro_nodes_add(cpu_set_t *nodes, cpu_set_t *cpus) {
+    char path[64], line[1024];
+    FILE *file;
+    int node;
+    for (node = 0; node < CPU_SETSIZE; node++) {
+        if (!CPU_ISSET(node, nodes))
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (!is_empty(file = fopen(path, "r"))) {
+            if (fgets(line, sizeof(line), file))
+                coro_cpulist_add(line, cpus);
+            fclose(file);
+        }
+    }
+}
+
+/* Resolve `coro_affinity_policy` into `coro_cpus`, before any worker thread is created. */
+static void coro_affinity_init(memory_t *scope) {
+    cpu_set_t allowed, wanted, nodes;
+    int cpu;
+
+    coro_cpu_count = 0;
+    if (coro_affinity_policy == CORO_AFFINITY_NONE
+        || sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return;
+
+    CPU_ZERO(&wanted);
+    if (coro_affinity_policy == CORO_AFFINITY_CPUSET) {
+        coro_cpulist_add(coro_affinity_list, &wanted);
+    } else if (coro_affinity_policy == CORO_AFFINITY_NODE) {
+        CPU_ZERO(&nodes);
+        coro_cpulist_add(coro_affinity_list, &nodes);
+        coro_nodes_add(&nodes, &wanted);
+    } else {
+        memcpy(&wanted, &allowed, sizeof(wanted));
+    }
+
+    CPU_AND(&wanted, &wanted, &allowed);
+    if (CPU_COUNT(&wanted) == 0) {
+        RAII_INFO("No allowed cpus for `coro_affinity` list `%s`, not pinning."CLR_LN, coro_affinity_list);
+        return;
+    }
+
+    coro_cpus = (int *)calloc_full(scope, CPU_COUNT(&wanted), sizeof(int), free);
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &wanted))
+            coro_cpus[coro_cpu_count++] = cpu;
+    }
+}
+
+/* Cpu for worker `id`, `RAII_ERR` if not pinning. */
+static int coro_affinity_cpu(u32 id) {
+    if (coro_cpu_count == 0)
+        return RAII_ERR;
+
+    if (coro_affinity_policy == CORO_AFFINITY_SCATTER && gq_result.thread_count <= coro_cpu_count)
+        return coro_cpus[(size_t)id * coro_cpu_count / gq_result.thread_count];
+
+    return coro_cpus[id % coro_cpu_count];
+}
+
+/* Pin calling worker thread `id`, then replace it's `deque` array allocated by main thread,
+with one first touched here, so the kernel places it on worker's local node. */
+static void coro_affinity_pin(raii_deque_t *queue, u32 id) {
+    cpu_set_t set;
+    int cpu = coro_affinity_cpu(id);
+    if (cpu == RAII_ERR)
+        return;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+        queue->cpu = cpu;
+        atomic_lock(&queue->push_lock);
+        deque_resize(queue, atomic_load(&queue->array)->size);
+        atomic_unlock(&queue->push_lock);
+    }
+}
+#else
+static void coro_affinity_init(memory_t *scope) {
+    (void)scope;
+    coro_cpu_count = 0;
+}
+
+static void coro_affinity_pin(raii_deque_t *queue, u32 id) {
+    (void)queue;
+    (void)id;
+}
+#endif
+
 static int thrd_coro_wrapper(void_t arg) {
     worker_t *pool = (worker_t *)arg;
     raii_deque_t *queue = (raii_deque_t *)pool->arg;
@@ -2353,19 +4576,42 @@ static int thrd_coro_wrapper(void_t arg) {
     pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
     coro_sched_init(false, tid);
-    /* Wait for global start signal */
-    while (!atomic_flag_load_explicit(&gq_result.is_started, memory_order_relaxed))
-        ;
+    coro_affinity_pin(queue, (u32)tid);
+    /* Wait for global start signal, or shutdown when main never started any coroutine */
+    while (!coro_park_started())
+        coro_park(coro_park_started, 0);
+
+    if (atomic_flag_load(&gq_result.is_started)) {
+        create_coro(coro_thread_main, queue, gq_result.stacksize * 6, CORO_RUN_THRD);
+        res = scheduler();
+    }
 
-    create_coro(coro_thread_main, queue, gq_result.stacksize * 6, CORO_RUN_THRD);
-    res = scheduler();
+    /* exited, idle from here on */
+    atomic_store_explicit(&coro_counters()->parked, get_timer(), memory_order_relaxed);
+    preempt_detach();
+    coro_reactor_free();
 
     if (!is_empty(coro()->sleep_handle) && coro()->sleep_handle->magic_number == CORO_MAGIC_NUMBER)
-        free(coro()->sleep_handle);
+        coro_stack_free(coro()->sleep_handle);
+
+    coro_timeout_free();
+    coro_stack_pool_trim(0);
+#if defined(USE_MMAP_STACK)
+    if (!is_empty(coro()->signal_stack)) {
+        stack_t stack;
+        stack.ss_sp = nullptr;
+        stack.ss_size = 0;
+        stack.ss_flags = SS_DISABLE;
+        sigaltstack(&stack, nullptr);
+        free(coro()->signal_stack);
+        coro()->signal_stack = nullptr;
+    }
+#endif
 
     if (coro_interrupt_set)
         coro_interrupt_shutdown(nullptr);
 
+    raii_pool_flush();
     rpmalloc_thread_finalize(1);
     thrd_exit(res);
     return res;
@@ -2379,6 +4625,30 @@ static void_t main_main(void_t v) {
     return 0;
 }
 
+/* Use environment `CORO_WORKERS` and `CORO_AFFINITY`, for what wasn't set by API. */
+static void coro_config_env(void) {
+    string_t env;
+    char *end;
+    unsigned long count;
+    if (coro_workers_requested == 0 && !is_empty((void_t)(env = getenv("CORO_WORKERS")))) {
+        /* Ignore negative, zero, or not an number, clamp huge to `CORO_WORKERS_MAX`. */
+        count = strtoul(env, &end, 10);
+        if (end != env && *end == '\0' && !strchr(env, '-') && count > 0)
+            coro_workers_requested = (u32)(count > CORO_WORKERS_MAX ? CORO_WORKERS_MAX : count);
+    }
+
+    if (!coro_affinity_requested && !is_empty((void_t)(env = getenv("CORO_AFFINITY")))) {
+        if (is_str_eq(env, "compact"))
+            coro_affinity(CORO_AFFINITY_COMPACT, nullptr);
+        else if (is_str_eq(env, "scatter"))
+            coro_affinity(CORO_AFFINITY_SCATTER, nullptr);
+        else if (strncmp(env, "cpuset:", 7) == 0)
+            coro_affinity(CORO_AFFINITY_CPUSET, env + 7);
+        else if (strncmp(env, "node:", 5) == 0)
+            coro_affinity(CORO_AFFINITY_NODE, env + 5);
+    }
+}
+
 static void coro_initialize(void) {
     atomic_thread_fence(memory_order_seq_cst);
     if (!coro_sys_set) {
@@ -2390,7 +4660,9 @@ static void coro_initialize(void) {
         gq_result.stacksize = CORO_STACK_SIZE;
         gq_result.is_takeable = 0;
         gq_result.cpu_count = thrd_cpu_count();
-        gq_result.thread_count = gq_result.cpu_count + 1;
+        coro_config_env();
+        gq_result.thread_count = coro_workers_requested > 0 ? coro_workers_requested
+            : CORO_WORKERS > 0 ? CORO_WORKERS : gq_result.cpu_count + 1;
         if (gq_result.queue_size == 0)
             gq_result.queue_size = 1 << (gq_result.cpu_count > 7
                                          ? 13
@@ -2399,7 +4671,9 @@ static void coro_initialize(void) {
         gq_result.queue = nullptr;
         gq_result.gc = nullptr;
         gq_result.group_result = nullptr;
-        atomic_init(&gq_result.results, nullptr);
+        atomic_init(&gq_result.result_free, 0);
+        atomic_flag_clear(&gq_result.result_lock);
+        gq_result.result_head = gq_result.result_tail = 0;
         atomic_init(&gq_result.result_id_generate, 0);
         atomic_init(&gq_result.id_generate, 0);
         atomic_init(&gq_result.active_count, 0);
@@ -2410,6 +4684,22 @@ static void coro_initialize(void) {
         atomic_flag_clear(&gq_result.is_waitable);
         atomic_flag_clear(&gq_result.is_disabled);
         atomic_flag_test_and_set(&gq_result.is_errorless);
+        atomic_init(&coro_parking.epoch, 0);
+        atomic_init(&coro_parking.waiters, 0);
+        if (mtx_init(&coro_parking.lock, mtx_plain) != thrd_success
+            || cnd_init(&coro_parking.wake) != thrd_success)
+            raii_panic("Parking `mtx_init/cnd_init` failed!");
+        if (mtx_init(&coro_stats_dumper.lock, mtx_plain) != thrd_success
+            || cnd_init(&coro_stats_dumper.wake) != thrd_success)
+            raii_panic("Stats `mtx_init/cnd_init` failed!");
+#if defined(CORO_REACTOR)
+        coro_parking.io_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mtx_init(&coro_fs_pool.lock, mtx_plain) != thrd_success
+            || cnd_init(&coro_fs_pool.wake) != thrd_success)
+            raii_panic("File offload `mtx_init/cnd_init` failed!");
+#else
+        coro_parking.io_wake = -1;
+#endif
 #if defined(_WIN32)
         QueryPerformanceFrequency(&gq_result.timer);
 #elif defined(__APPLE__) || defined(__MACH__)
@@ -2419,6 +4709,483 @@ static void coro_initialize(void) {
     }
 }
 
+/* Deque holding counters of worker thread `thrd_id`, `nullptr` if none. */
+static raii_deque_t *coro_stats_queue(u32 thrd_id) {
+    raii_deque_t *queue = gq_result.queue;
+    if (is_empty(queue) || queue->type != RAII_POOL)
+        return nullptr;
+
+    if (is_empty(queue->local))
+        return thrd_id == 0 ? queue : nullptr;
+
+    return thrd_id < gq_result.thread_count ? queue->local[thrd_id] : nullptr;
+}
+
+static void coro_stats_add(coro_stats_t *stats, raii_deque_t *queue, size_t now) {
+    coro_counters_t *counters = &queue->counters;
+    size_t elapsed, idle, parked, started = atomic_load_explicit(&counters->started, memory_order_relaxed);
+
+    stats->workers++;
+    stats->switches += atomic_load_explicit(&counters->switches, memory_order_relaxed);
+    stats->spawned += atomic_load_explicit(&counters->spawned, memory_order_relaxed);
+    stats->completed += atomic_load_explicit(&counters->completed, memory_order_relaxed);
+    stats->stolen += atomic_load_explicit(&queue->steal_taken, memory_order_relaxed);
+    stats->steal_failures += atomic_load_explicit(&queue->steal_failures, memory_order_relaxed);
+    stats->queued += atomic_load_explicit(&counters->queued, memory_order_relaxed)
+        + atomic_load_explicit(&queue->available, memory_order_relaxed);
+    stats->sleeping += atomic_load_explicit(&counters->sleeping, memory_order_relaxed);
+    if (started == 0 || now < started)
+        return;
+
+    /* include an park still in progress */
+    parked = atomic_load_explicit(&counters->parked, memory_order_relaxed);
+    idle = atomic_load_explicit(&counters->idle_ns, memory_order_relaxed);
+    if (parked != 0 && now > parked)
+        idle += now - parked;
+
+    elapsed = now - started;
+    if (idle > elapsed)
+        idle = elapsed;
+
+    stats->idle_ns += idle;
+    stats->run_ns += elapsed - idle;
+}
+
+coro_stats_t coro_stats_worker(u32 thrd_id) {
+    coro_stats_t stats;
+    raii_deque_t *queue;
+
+    memset(&stats, 0, sizeof(stats));
+    if (!is_empty(queue = coro_stats_queue(thrd_id)))
+        coro_stats_add(&stats, queue, get_timer());
+
+    return stats;
+}
+
+coro_stats_t coro_stats_snapshot(void) {
+    coro_stats_t stats;
+    raii_deque_t *queue;
+    size_t now = get_timer();
+    u32 i;
+
+    memset(&stats, 0, sizeof(stats));
+    for (i = 0; !is_empty(queue = coro_stats_queue(i)); i++)
+        coro_stats_add(&stats, queue, now);
+
+    return stats;
+}
+
+static void coro_stats_json(FILE *out, coro_stats_t *stats) {
+    fprintf(out, "{\"workers\":%zu,\"switches\":%zu,\"spawned\":%zu,\"completed\":%zu,"
+            "\"stolen\":%zu,\"steal_failures\":%zu,\"queued\":%zu,\"sleeping\":%zu,"
+            "\"run_ns\":%zu,\"idle_ns\":%zu",
+            stats->workers, stats->switches, stats->spawned, stats->completed,
+            stats->stolen, stats->steal_failures, stats->queued, stats->sleeping,
+            stats->run_ns, stats->idle_ns);
+}
+
+void coro_stats_print(FILE *out) {
+    coro_stats_t stats, worker;
+    raii_deque_t *queue;
+    size_t now = get_timer();
+    u32 i;
+
+    stats = coro_stats_snapshot();
+    fprintf(out, "{\"time_ns\":%zu,\"total\":", now);
+    coro_stats_json(out, &stats);
+    fputs("},\"threads\":[", out);
+    for (i = 0; !is_empty(queue = coro_stats_queue(i)); i++) {
+        memset(&worker, 0, sizeof(worker));
+        coro_stats_add(&worker, queue, now);
+        fputs(i ? "," : "", out);
+        coro_stats_json(out, &worker);
+        fprintf(out, ",\"cpu\":%d}", queue->cpu);
+    }
+    fputs("]}\n", out);
+    fflush(out);
+}
+
+static int coro_stats_dump(void_t arg) {
+    struct timespec ts;
+    struct timeval tv;
+    size_t timeout;
+    (void)arg;
+
+    mtx_lock(&coro_stats_dumper.lock);
+    while (coro_stats_dumper.running) {
+        timeout = (size_t)coro_stats_dumper.interval * 1000000;
+        gettimeofday(&tv, nullptr);
+        ts.tv_sec = tv.tv_sec + timeout / 1000000000;
+        ts.tv_nsec = tv.tv_usec * 1000 + timeout % 1000000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        /* signaled, to stop or change interval */
+        if (cnd_timedwait(&coro_stats_dumper.wake, &coro_stats_dumper.lock, &ts) == thrd_success)
+            continue;
+
+        coro_stats_print(coro_stats_dumper.out);
+    }
+    mtx_unlock(&coro_stats_dumper.lock);
+
+    return 0;
+}
+
+/* Stop periodic dump, counters are about to be freed. */
+static void coro_stats_stop(void) {
+    if (!coro_stats_dumper.running)
+        return;
+
+    mtx_lock(&coro_stats_dumper.lock);
+    coro_stats_dumper.running = false;
+    cnd_signal(&coro_stats_dumper.wake);
+    mtx_unlock(&coro_stats_dumper.lock);
+    thrd_join(coro_stats_dumper.thread, nullptr);
+}
+
+void coro_stats_every(FILE *out, u32 ms) {
+    coro_initialize();
+    coro_stats_stop();
+    if (ms == 0 || is_empty(out))
+        return;
+
+    coro_stats_dumper.out = out;
+    coro_stats_dumper.interval = ms;
+    coro_stats_dumper.running = true;
+    if (thrd_create(&coro_stats_dumper.thread, coro_stats_dump, nullptr) != thrd_success) {
+        coro_stats_dumper.running = false;
+        throw(future_error);
+    }
+}
+
+static RAII_INLINE void coro_profile_max(atomic_size_t *max, size_t n) {
+    if (n > atomic_load_explicit(max, memory_order_relaxed))
+        atomic_store_explicit(max, n, memory_order_relaxed);
+}
+
+/* Slot of `t` in thread's profile table, claiming an free one for new names. */
+static coro_profile_entry_t *coro_profile_entry(coro_profile_t *table, routine_t *t) {
+    coro_profile_entry_t *entry;
+    size_t i, key, hash = 2166136261u;
+    const unsigned char *p = (const unsigned char *)t->name;
+    bool named = t->name[0] != '\0';
+
+    if (named) {
+        for (; *p; p++)
+            hash = (hash ^ *p) * 16777619u;
+    } else {
+        hash = ((size_t)t->func >> 4) * 2654435761u;
+    }
+
+    hash |= 1;
+    for (i = 0; i < CORO_PROFILE_SLOTS; i++) {
+        entry = &table->entries[(hash + i) % CORO_PROFILE_SLOTS];
+        if ((key = atomic_load_explicit(&entry->key, memory_order_relaxed)) == 0) {
+            entry->func = t->func;
+            if (named)
+                memcpy(entry->name, t->name, sizeof(entry->name));
+            else
+                snprintf(entry->name, sizeof(entry->name), "%p", (void_t)t->func);
+
+            /* publish name, before readers can see slot used */
+            atomic_store_explicit(&entry->key, hash, memory_order_release);
+            return entry;
+        }
+
+        if (key == hash && (named ? strcmp(entry->name, t->name) == 0 : entry->func == t->func))
+            return entry;
+    }
+
+    return &table->other;
+}
+
+/* Reset table of calling thread, left from an earlier `coro_profile_start`. */
+static void coro_profile_reset(coro_profile_t *table, size_t epoch) {
+    u32 i;
+
+    /* hide slots from readers, before clearing names */
+    for (i = 0; i < CORO_PROFILE_SLOTS; i++)
+        atomic_store_explicit(&table->entries[i].key, 0, memory_order_relaxed);
+
+    atomic_store_explicit(&table->epoch, 0, memory_order_release);
+    memset(&table->other, 0, sizeof(table->other));
+    memset(table->entries, 0, sizeof(table->entries));
+    strcpy(table->other.name, "[other]");
+    atomic_store_explicit(&table->epoch, epoch, memory_order_release);
+}
+
+static void coro_profile_slice(routine_t *t, size_t ns) {
+    coro_profile_entry_t *entry;
+    coro_profile_t *table;
+    size_t us = ns / 1000, epoch;
+    u32 bucket = 0;
+
+    if (is_empty(coro_profiler.tables) || coro()->thrd_id >= coro_profiler.count)
+        return;
+
+    table = coro_profiler.tables[coro()->thrd_id];
+    epoch = atomic_load_explicit(&coro_profiler.epoch, memory_order_acquire);
+    if (atomic_load_explicit(&table->epoch, memory_order_relaxed) != epoch)
+        coro_profile_reset(table, epoch);
+
+    entry = coro_profile_entry(table, t);
+    while (us && bucket < CORO_PROFILE_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    coro_count(&entry->slices, 1);
+    coro_count(&entry->total_ns, ns);
+    coro_count(&entry->buckets[bucket], 1);
+    coro_profile_max(&entry->max_ns, ns);
+    if (coro_profiler.threshold_ns && ns > coro_profiler.threshold_ns) {
+        coro_count(&entry->slow, 1);
+        coro_count(&entry->slow_ns, ns);
+    }
+}
+
+void coro_profile_start(u32 threshold_us) {
+    u32 i;
+
+    coro_initialize();
+    coro_profile_stop();
+    if (is_empty(coro_profiler.tables)) {
+        coro_profiler.count = gq_result.thread_count;
+        coro_profiler.tables = try_calloc(coro_profiler.count, sizeof(coro_profile_t *));
+        for (i = 0; i < coro_profiler.count; i++)
+            coro_profiler.tables[i] = try_calloc(1, sizeof(coro_profile_t));
+    }
+
+    /* an thread still in `coro_profile_slice` may write it's table, leave it
+    to be reset by that thread, on it's next slice */
+    atomic_fetch_add_explicit(&coro_profiler.epoch, 1, memory_order_release);
+    coro_profiler.threshold_ns = (size_t)threshold_us * 1000;
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_flag_test_and_set(&coro_profiler.enabled);
+}
+
+void coro_profile_stop(void) {
+    atomic_flag_clear(&coro_profiler.enabled);
+}
+
+static void coro_profile_free(void) {
+    u32 i;
+
+    coro_profile_stop();
+    if (!is_empty(coro_profiler.tables)) {
+        for (i = 0; i < coro_profiler.count; i++)
+            free(coro_profiler.tables[i]);
+
+        free(coro_profiler.tables);
+        coro_profiler.tables = nullptr;
+    }
+}
+
+/* Call `fn` with every used entry, of every thread. */
+static void coro_profile_each(void (*fn)(FILE *, u32, coro_profile_entry_t *), FILE *out) {
+    coro_profile_t *table;
+    size_t epoch = atomic_load_explicit(&coro_profiler.epoch, memory_order_acquire);
+    u32 i, j;
+
+    if (is_empty(coro_profiler.tables))
+        return;
+
+    for (i = 0; i < coro_profiler.count; i++) {
+        table = coro_profiler.tables[i];
+        /* no slice since last start, nothing current in it */
+        if (atomic_load_explicit(&table->epoch, memory_order_acquire) != epoch)
+            continue;
+
+        for (j = 0; j < CORO_PROFILE_SLOTS; j++) {
+            if (atomic_load_explicit(&table->entries[j].key, memory_order_acquire) != 0)
+                fn(out, i, &table->entries[j]);
+        }
+
+        if (atomic_load_explicit(&table->other.slices, memory_order_relaxed) > 0)
+            fn(out, i, &table->other);
+    }
+}
+
+static void coro_profile_fold(FILE *out, u32 thrd_id, coro_profile_entry_t *entry) {
+    size_t total = atomic_load_explicit(&entry->total_ns, memory_order_relaxed),
+        slow = atomic_load_explicit(&entry->slow_ns, memory_order_relaxed);
+
+    if (slow > total)
+        slow = total;
+
+    if ((total - slow) / 1000 > 0)
+        fprintf(out, "thread %u;%s %zu\n", thrd_id, entry->name, (total - slow) / 1000);
+
+    if (slow / 1000 > 0)
+        fprintf(out, "thread %u;%s;[slow] %zu\n", thrd_id, entry->name, slow / 1000);
+}
+
+void coro_profile_folded(FILE *out) {
+    coro_profile_each(coro_profile_fold, out);
+    fflush(out);
+}
+
+static void coro_profile_line(FILE *out, u32 thrd_id, coro_profile_entry_t *entry) {
+    size_t slices = atomic_load_explicit(&entry->slices, memory_order_relaxed),
+        total = atomic_load_explicit(&entry->total_ns, memory_order_relaxed);
+    u32 i;
+
+    fprintf(out, "%-6u %-32s %10zu %12zu %10zu %10zu %8zu  ", thrd_id, entry->name, slices,
+            total / 1000, slices ? total / slices / 1000 : 0,
+            atomic_load_explicit(&entry->max_ns, memory_order_relaxed) / 1000,
+            atomic_load_explicit(&entry->slow, memory_order_relaxed));
+    for (i = 0; i < CORO_PROFILE_BUCKETS; i++)
+        fprintf(out, "%s%zu", i ? " " : "", atomic_load_explicit(&entry->buckets[i], memory_order_relaxed));
+
+    fputs("\n", out);
+}
+
+void coro_profile_report(FILE *out) {
+    fprintf(out, "%-6s %-32s %10s %12s %10s %10s %8s  %s\n", "thread", "name", "slices",
+            "total_us", "avg_us", "max_us", "slow", "histogram <1us, <2us, <4us ...");
+    coro_profile_each(coro_profile_line, out);
+    fflush(out);
+}
+
+static void coro_trace_put(coro_trace_kind kind, u32 cid, u32 arg, size_t ts, size_t dur) {
+    coro_trace_ring_t *ring;
+    coro_trace_event_t *event;
+    size_t head;
+
+    if (is_empty(coro_tracer.rings) || coro()->thrd_id >= coro_tracer.count)
+        return;
+
+    ring = coro_tracer.rings[coro()->thrd_id];
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    event = &ring->events[head & ring->mask];
+    event->ts = ts;
+    event->dur = dur;
+    event->cid = cid;
+    event->arg = arg;
+    event->kind = kind;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void coro_trace(coro_trace_kind kind, u32 arg) {
+    if (atomic_flag_load_explicit(&coro_tracer.enabled, memory_order_relaxed))
+        coro_trace_put(kind, is_empty(coro()->running) ? 0 : coro()->running->cid, arg, get_timer(), 0);
+}
+
+void coro_trace_start(u32 events) {
+    coro_trace_ring_t *ring;
+    size_t capacity = 1;
+    u32 i;
+
+    coro_initialize();
+    coro_trace_stop();
+    if (events == 0)
+        events = CORO_TRACE_EVENTS;
+
+    while (capacity < events)
+        capacity <<= 1;
+
+    /* Rings are only replaced when growing, never freed till `coro_trace_free` on
+    scheduler teardown, workers already past `enabled` check still write old ones. */
+    if (is_empty(coro_tracer.rings)) {
+        coro_tracer.count = gq_result.thread_count;
+        coro_tracer.rings = try_calloc(coro_tracer.count, sizeof(coro_trace_ring_t *));
+    }
+
+    for (i = 0; i < coro_tracer.count; i++) {
+        ring = coro_tracer.rings[i];
+        if (is_empty(ring) || ring->size < capacity) {
+            ring = try_calloc(1, sizeof(coro_trace_ring_t)
+                              + sizeof(coro_trace_event_t) * (capacity - 1));
+            ring->size = capacity;
+            ring->retired = coro_tracer.rings[i];
+            coro_tracer.rings[i] = ring;
+        }
+
+        atomic_init(&ring->head, 0);
+        ring->mask = capacity - 1;
+    }
+
+    coro_tracer.capacity = capacity;
+    coro_tracer.started = get_timer();
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_flag_test_and_set(&coro_tracer.enabled);
+}
+
+void coro_trace_stop(void) {
+    atomic_flag_clear(&coro_tracer.enabled);
+}
+
+static void coro_trace_free(void) {
+    coro_trace_ring_t *ring, *retired;
+    u32 i;
+
+    coro_trace_stop();
+    if (!is_empty(coro_tracer.rings)) {
+        for (i = 0; i < coro_tracer.count; i++) {
+            for (ring = coro_tracer.rings[i]; !is_empty(ring); ring = retired) {
+                retired = ring->retired;
+                free(ring);
+            }
+        }
+
+        free(coro_tracer.rings);
+        coro_tracer.rings = nullptr;
+    }
+}
+
+void coro_trace_dump(FILE *out) {
+    static const char *names[] = {
+        "spawn", "switch", "yield", "sleep", "wake", "steal",
+        "take", "transfer", "group_done", "chan_block"
+    };
+    /* what `arg` holds, per event kind */
+    static const char *args[] = {
+        "tid", nullptr, nullptr, "ms", "tid", "victim",
+        "count", "from", "waiter", "op"
+    };
+    coro_trace_ring_t *ring;
+    coro_trace_event_t *event;
+    size_t head, pos;
+    bool first = true;
+    u32 i;
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (i = 0; !is_empty(coro_tracer.rings) && i < coro_tracer.count; i++) {
+        ring = coro_tracer.rings[i];
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0)
+            continue;
+
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s %u\"}}", first ? "" : ",", i, i ? "worker" : "main", i);
+        first = false;
+        for (pos = head > ring->mask ? head - ring->mask - 1 : 0; pos < head; pos++) {
+            event = &ring->events[pos & ring->mask];
+            if (event->ts < coro_tracer.started)
+                continue;
+
+            if (event->kind == CORO_TRACE_SWITCH) {
+                fprintf(out, ",\n{\"name\":\"coro #%u\",\"cat\":\"coro\",\"ph\":\"X\",\"ts\":%.3f,"
+                        "\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"cid\":%u}}",
+                        event->cid, (event->ts - coro_tracer.started) / 1e3, event->dur / 1e3, i, event->cid);
+            } else {
+                fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"sched\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                        "\"pid\":1,\"tid\":%u,\"args\":{\"cid\":%u",
+                        names[event->kind], (event->ts - coro_tracer.started) / 1e3, i, event->cid);
+                if (!is_empty((void_t)args[event->kind]))
+                    fprintf(out, ",\"%s\":%u", args[event->kind], event->arg);
+
+                fputs("}}", out);
+            }
+        }
+    }
+
+    fputs("\n]}\n", out);
+    fflush(out);
+}
+
 int raii_main(int argc, char **argv) {
 	coro_argc = argc;
 	coro_argv = argv;
@@ -2445,15 +5212,24 @@ static RAII_INLINE void coro_post_available(void) {
     gq_result.is_takeable++;
     for (i = 0; i < cap; i++) {
         if (t = ((routine_t *)hash_pair_value(pair = hash_buckets(wg, i)).object)) {
-            coro_atomic_enqueue(t);
+            if (!t->posted) {
+                t->posted = true;
+                coro_atomic_enqueue(t);
+            }
+
             if (++count == hash_count(wg))
                 break;
         }
     }
 
     for (i = 0; i < gq_result.thread_count; i++) {
-        atomic_flag_clear(&gq_result.queue->local[i]->taken);
-        gq_result.queue->local[i]->grouped = wg;
+        raii_deque_t *queue = gq_result.queue->local[i];
+        queue->grouped = wg;
+        /* Given nothing, an idle thread won't wake to take, count it here. */
+        if (atomic_load(&queue->available) == 0)
+            coro_take_done(queue);
+        else
+            atomic_flag_clear(&queue->taken);
     }
 }
 
@@ -2478,6 +5254,7 @@ void coro_stealer(void) {
 
         if (!atomic_flag_load(&gq_result.is_started)) {
             atomic_flag_test_and_set(&gq_result.is_started);
+            coro_unpark();
         }
     }
 
@@ -2489,6 +5266,7 @@ void coro_stealer(void) {
 }
 
 RAII_INLINE void yield(void) {
+    coro_traced(CORO_TRACE_YIELD, coro()->running->cid, 0);
     coro_stealer();
     coro_enqueue(coro()->running);
     coro_suspend();
@@ -2511,9 +5289,13 @@ RAII_INLINE string_t catch_message(void) {
 }
 
 RAII_INLINE template result_for(rid_t id) {
+    template valued;
     result_t value = raii_result_get(id);
-    if (value->is_ready)
-        return value->result->valued;
+    if (value->is_ready) {
+        valued = value->result->valued;
+        raii_result_free(id);
+        return valued;
+    }
 
     throw(logic_error);
 }
@@ -2536,12 +5318,10 @@ waitgroup_t waitgroup_ex(u32 capacity) {
         atomic_thread_fence(memory_order_seq_cst);
         for (i = 0; i < gq_result.thread_count; i++) {
             raii_deque_t *q = gq_result.queue->local[i];
-            if (atomic_load_explicit(&q->array->size, memory_order_relaxed) < resized) {
-                deque_array_t *a = (deque_array_t *)atomic_load_explicit(&q->array, memory_order_acquire);
-                a = try_realloc(a, sizeof(deque_array_t) + sizeof(routine_t *) * resized);
-                atomic_store_explicit(&q->array, a, memory_order_release);
-                atomic_store(&a->size, resized);
-            }
+            atomic_lock(&q->push_lock);
+            if (atomic_load_explicit(&q->array->size, memory_order_relaxed) < resized)
+                deque_resize(q, resized);
+            atomic_unlock(&q->push_lock);
         }
     }
 
@@ -2557,19 +5337,24 @@ waitresult_t waitfor(waitgroup_t wg) {
     string_t key = nullptr;
     waitresult_t wgr = nullptr;
     hash_pair_t *pair = nullptr;
+    wait_state_t *state = nullptr;
     u32 group_capacity, cap, i;
-    bool is_wait = false, has_completed = false;
+    int ran;
+    bool is_wait = false, has_completed = false, has_local, is_legacy;
 
     if (c->wait_active && is_equal_ex(c->wait_group, wg)) {
         c->is_group_finish = true;
         if (coro_sched_is_assignable(coro_queue_active_count())
             && !atomic_flag_load_explicit(&gq_result.is_disabled, memory_order_relaxed))
             atomic_flag_test_and_set(&gq_result.is_waitable);
+        else if (coro_is_threading() && !is_empty(state = coro_group_state(c, wg)) && !state->is_legacy)
+            coro_group_post(wg);
 
         atomic_lock(&gq_result.group_lock);
         if (is_empty(gq_result.group_result)) {
-            wgr = array_of(c->scope, 0);
+            wgr = array_reserve(array_of(c->scope, 0), hash_count(wg) + 1);
             array_deferred_set(wgr, c->scope);
+            raii_deferred(c->scope, (func_t)coro_group_result_free, wgr);
             gq_result.group_result = wgr;
         }
         atomic_unlock(&gq_result.group_lock);
@@ -2578,62 +5363,86 @@ waitresult_t waitfor(waitgroup_t wg) {
         if (coro_interrupt_set && !atomic_flag_load(&gq_result.is_disabled))
             coro_flag_set(coro_running());
 
-        if (is_wait = atomic_flag_load(&gq_result.is_waitable)) {
-            group_capacity = coro()->group_count;
-            coro()->group_count = 0;
-            gq_result.queue->grouped = nullptr;
-        }
+        state = coro_group_state(c, wg);
+        if (!is_empty(state) && !state->is_legacy) {
+            /* An earlier round, still being taken, skips posting this one. */
+            if (coro_is_threading())
+                coro_group_post(wg);
 
-        while (hash_count(wg) && !has_completed) {
-            cap = (u32)hash_capacity(wg);
-            for (i = 0; i < cap; i++) {
-                if (co = ((routine_t *)hash_pair_value(pair = hash_buckets(wg, i)).object)) {
-                    key = hash_pair_key(pair);
-                    if (is_wait && group_capacity == 0) {
-                        has_completed = true;
-                        break;
-                    } else if (is_wait && co->tid != coro()->thrd_id) {
-                        continue;
-                    } else if (!coro_terminated(co)) {
-                        if (!co->interrupt_active && co->status == CORO_NORMAL) {
-                            if (coro_interrupt_set && !atomic_flag_load(&gq_result.is_disabled))
-                                coro_flag_set(co);
+            coro_group_wait(state);
+        } else {
+            if (is_wait = atomic_flag_load(&gq_result.is_waitable)) {
+                group_capacity = coro()->group_count;
+                coro()->group_count = 0;
+                gq_result.queue->grouped = nullptr;
+            }
 
-                            coro_enqueue(co);
-                        } else if (co->interrupt_active && co->status == CORO_SUSPENDED) {
-                            coro_flag_set(co);
-                            coro_enqueue(co);
+            while (hash_count(wg) && !has_completed) {
+                cap = (u32)hash_capacity(wg);
+                has_local = false;
+                ran = 0;
+                for (i = 0; i < cap; i++) {
+                    if (co = ((routine_t *)hash_pair_value(pair = hash_buckets(wg, i)).object)) {
+                        key = hash_pair_key(pair);
+                        if (is_wait && group_capacity == 0) {
+                            has_completed = true;
+                            break;
+                        } else if (is_wait && co->tid != coro()->thrd_id) {
+                            continue;
                         }
 
-                        coro_info(c, 1);
-                        coro_yielding_active();
-                    } else {
-                        if (is_wait)
-                            group_capacity--;
-
-                        if (!is_empty(co->results) && co->rid != RAII_ERR)
-                            coro_group_result_set(co);
-
-                        if (co->interrupt_active) {
-                            if (coro_queue_active_count() > 0)
-                                atomic_fetch_sub(&gq_result.active_count, 1);
-                            coro_deferred_free(co);
-                            co->magic_number = RAII_ERR;
-                            free(co);
+                        has_local = true;
+                        if (!coro_terminated(co)) {
+                            if (!co->interrupt_active && co->status == CORO_NORMAL) {
+                                if (coro_interrupt_set && !atomic_flag_load(&gq_result.is_disabled))
+                                    coro_flag_set(co);
+
+                                coro_enqueue(co);
+                            } else if (co->interrupt_active && co->status == CORO_SUSPENDED) {
+                                coro_flag_set(co);
+                                coro_enqueue(co);
+                            }
+
+                            coro_info(c, 1);
+                            ran += coro_yielding_active();
                         } else {
-                            coro_delete(co);
-                        }
+                            if (is_wait)
+                                group_capacity--;
+
+                            if (!is_empty(co->results) && co->rid != RAII_ERR)
+                                coro_group_result_set(co);
+
+                            if (co->interrupt_active) {
+                                if (coro_queue_active_count() > 0)
+                                    atomic_fetch_sub(&gq_result.active_count, 1);
+                                coro_deferred_free(co);
+                                coro_stack_release(co);
+                            } else {
+                                coro_delete(co);
+                            }
 
-                        hash_delete(wg, key);
+                            hash_delete(wg, key);
+                        }
                     }
                 }
+
+                if (!has_completed && !has_local)
+                    ran += coro_yielding_active();
+
+                if (!has_completed && ran <= 0)
+                    thrd_yield();
             }
-        }
 
-        while (is_wait && hash_count(wg)) {
-            yield();
+            while (is_wait && hash_count(wg)) {
+                if (coro_yielding_active() <= 0)
+                    thrd_yield();
+            }
         }
 
+        is_legacy = is_empty(state) || state->is_legacy;
+        if (!is_empty(state))
+            coro_group_free(c, state);
+
         c->wait_active = false;
         c->wait_group = nullptr;
         atomic_lock(&gq_result.group_lock);
@@ -2642,7 +5451,10 @@ waitresult_t waitfor(waitgroup_t wg) {
             gq_result.group_result = nullptr;
 
         atomic_unlock(&gq_result.group_lock);
-        --coro()->used_count;
+        /* Completion list members are fully accounted for by `scheduler`. */
+        if (is_legacy)
+            --coro()->used_count;
+
         hash_free(wg);
 
         return wgr;
@@ -2653,22 +5465,48 @@ waitresult_t waitfor(waitgroup_t wg) {
 
 rid_t go(callable_t fn, u64 num_of_args, ...) {
     va_list ap;
+    rid_t rid;
+
+    va_start(ap, num_of_args);
+    rid = coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_NORMAL);
+    va_end(ap);
+
+    return rid;
+}
+
+rid_t go_priority(coro_priority_t priority, callable_t fn, u64 num_of_args, ...) {
+    va_list ap;
+    rid_t rid;
+
+    coro()->spawn_priority = priority < CORO_PRIORITY_HIGH ? CORO_PRIORITY_HIGH
+        : priority > CORO_PRIORITY_LOW ? CORO_PRIORITY_LOW : priority;
+    va_start(ap, num_of_args);
+    rid = coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_NORMAL);
+    va_end(ap);
+
+    return rid;
+}
+
+rid_t go_deadline(u32 ms, callable_t fn, u64 num_of_args, ...) {
+    va_list ap;
+    rid_t rid;
 
+    coro()->spawn_priority = CORO_PRIORITY_HIGH;
+    coro()->spawn_deadline = get_timer() + (size_t)ms * 1000000;
     va_start(ap, num_of_args);
-    params_t params = array_ex(coro_scope(), num_of_args, ap);
+    rid = coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_NORMAL);
     va_end(ap);
 
-    return create_coro((raii_func_t)fn, params, gq_result.stacksize, CORO_RUN_NORMAL);
+    return rid;
 }
 
 void launch(func_t fn, u64 num_of_args, ...) {
     va_list ap;
 
     va_start(ap, num_of_args);
-    params_t params = array_ex(coro_scope(), num_of_args, ap);
+    coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_NORMAL);
     va_end(ap);
 
-    create_coro((raii_func_t)fn, params, gq_result.stacksize, CORO_RUN_NORMAL);
     yield();
 }
 
@@ -2679,10 +5517,9 @@ awaitable_t async(callable_t fn, u64 num_of_args, ...) {
     waitgroup_t wg = waitgroup_ex(2);
 
     va_start(ap, num_of_args);
-    params_t params = array_ex(c->scope, num_of_args, ap);
+    rid_t rid = coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_ASYNC);
     va_end(ap);
 
-    rid_t rid = create_coro((raii_func_t)fn, params, gq_result.stacksize, CORO_RUN_ASYNC);
     c->wait_group = nullptr;
     awaitable->wg = wg;
     awaitable->cid = rid;
@@ -2717,10 +5554,9 @@ generator_t generator(callable_t fn, u64 num_of, ...) {
     va_list ap;
 
     va_start(ap, num_of);
-    params_t params = array_ex(c->scope, num_of, ap);
+    rid_t rid = coro_spawn((raii_func_t)fn, num_of, ap, gq_result.stacksize, CORO_RUN_NORMAL);
     va_end(ap);
 
-    rid_t rid = create_coro((raii_func_t)fn, params, gq_result.stacksize, CORO_RUN_NORMAL);
     t = (routine_t *)((template_t *)hash_get(wg, __itoa(rid)))->object;
     if (!snprintf(t->name, sizeof(t->name), "Generator #%d", (int)rid))
         RAII_LOG("Invalid generator");
@@ -2736,6 +5572,11 @@ generator_t generator(callable_t fn, u64 num_of, ...) {
     t->is_waiting = false;
     t->context = c;
 
+    if (!is_empty(t->group)) {
+        coro_group_free(c, t->group);
+        t->group = nullptr;
+    }
+
     c->wait_group = nullptr;
     c->wait_active = false;
     c->is_group_finish = true;
@@ -2801,10 +5642,9 @@ template coro_await(callable_t fn, size_t num_of_args, ...) {
     coro_active()->interrupt_active = true;
 
     va_start(ap, num_of_args);
-    params_t params = array_ex(coro_scope(), num_of_args, ap);
+    rid_t rid = coro_spawn((raii_func_t)fn, num_of_args, ap, gq_result.stacksize, CORO_RUN_NORMAL);
     va_end(ap);
 
-    rid_t rid = create_coro((raii_func_t)fn, params, gq_result.stacksize, CORO_RUN_NORMAL);
     waitresult_t wgr = waitfor(wg);
     if ($size(wgr) > 0)
         return result_for(rid);
@@ -2816,10 +5656,9 @@ void coro_launch(callable_t fn, u64 num_of_args, ...) {
     va_list ap;
 
     va_start(ap, num_of_args);
-    params_t params = array_ex(coro_scope(), num_of_args, ap);
+    coro_spawn((raii_func_t)fn, num_of_args, ap, Kb(16), CORO_RUN_INTERRUPT);
     va_end(ap);
 
-    create_coro((raii_func_t)fn, params, Kb(16), CORO_RUN_INTERRUPT);
     yield();
 }
 
@@ -2862,18 +5701,18 @@ void coro_detached(routine_t *co) {
 
 static void coro_await_result(routine_t *co, void_t data, ptrdiff_t plain, bool is_plain) {
 	if (is_addressable(co) && (is_plain || (!is_empty(data) && co->rid != RAII_ERR))) {
-        rid_t id = co->rid;
-        result_t *results = (result_t *)atomic_load_explicit(&gq_result.results, memory_order_acquire);
-        atomic_thread_fence(memory_order_seq_cst);
+        result_t result = raii_result_get(co->rid);
         if (is_plain)
             co->interrupt_result->valued.long_long = plain;
         else
             co->interrupt_result->valued.object = data;
 
-        results[id]->result = co->interrupt_result;
-        co->results = &results[id]->result->valued;
-        results[id]->is_ready = true;
-        atomic_store_explicit(&gq_result.results, results, memory_order_release);
+        if (is_type(result, RAII_VALUE)) {
+            result->result = co->interrupt_result;
+            co->results = &result->result->valued;
+            atomic_thread_fence(memory_order_release);
+            result->is_ready = true;
+        }
     }
 }
 
@@ -2985,7 +5824,7 @@ static RAII_INLINE void coro_destroy(void) {
         atomic_lock(&gq_result.group_lock);
         foreach(t in gq_result.gc) {
             if (((routine_t *)t.object)->magic_number == CORO_MAGIC_NUMBER)
-                free(t.object);
+                coro_stack_free((routine_t *)t.object);
         }
 
         array_delete(gq_result.gc);
@@ -2998,6 +5837,8 @@ RAII_INLINE void coro_gc(routine_t *co) {
     atomic_lock(&gq_result.group_lock);
     if (is_empty(gq_result.gc))
         gq_result.gc = array_of(gq_result.scope, 0);
+    else
+        gq_result.gc = array_reserve(gq_result.gc, $size(gq_result.gc) + 1);
 
     if (co->magic_number == CORO_MAGIC_NUMBER)
         $append(gq_result.gc, co);
@@ -3020,6 +5861,13 @@ RAII_INLINE routine_t *coro_ref_current(void) {
     return t;
 }
 
+RAII_INLINE routine_t *coro_park_current(void) {
+    routine_t *t = coro_ref_current();
+    t->parked = true;
+
+    return t;
+}
+
 RAII_INLINE void_t coro_await_erred(routine_t *co, int code) {
     co->is_event_err = true;
     co->event_err_code = code;
@@ -3070,6 +5918,7 @@ raii_deque_t *coro_pool_init(size_t queue_size) {
         size_t i;
         unique_t *scope = gq_result.scope, *global = coro_sys_set ? coro_scope() : raii_init();
         if (queue_size > 0 && coro_threading_enabled) {
+            coro_affinity_init(scope);
             local = (raii_deque_t **)calloc_full(scope, gq_result.thread_count, sizeof(local[0]), free);
             local[0] = (raii_deque_t *)malloc_full(scope, sizeof(raii_deque_t), (func_t)deque_free);
             deque_init(local[0], queue_size);
@@ -3151,6 +6000,8 @@ string cin(size_t length) {
 	}
 
 	fflush(stdout);
+	/* let other coroutines run, until there is input */
+	coro_io_wait(STDIN_FILENO, false);
 	if ((count = read(STDIN_FILENO, buf, len)) > 0) {
 		buf[count] = '\0';
 		return buf;
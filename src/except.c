@@ -68,10 +68,12 @@ ex_setup_func exception_setup_func = NULL;
 ex_unwind_func exception_unwind_func = NULL;
 ex_terminate_func exception_ctrl_c_func = NULL;
 ex_terminate_func exception_terminate_func = NULL;
+ex_guard_func exception_guard_func = NULL;
 bool exception_signal_set = false;
 
 static void ex_handler(int sig);
 #if !defined(_WIN32)
+static void ex_sig_handler(int sig, siginfo_t *info, void *context);
 static struct sigaction ex_sig_sa = {0}, ex_sig_osa = {0};
 #endif
 
@@ -564,6 +566,20 @@ void ex_handler(int sig) {
     ex_throw(ex, "unknown", 0, NULL, NULL, NULL);
 }
 
+#if !defined(_WIN32)
+static void ex_sig_handler(int sig, siginfo_t *info, void *context) {
+    (void)context;
+    if ((sig == SIGSEGV || sig == SIGBUS) && exception_guard_func
+        && exception_guard_func(info->si_addr)) {
+        got_signal = true;
+        ex_init()->caught = sig;
+        ex_throw(EX_NAME(stack_overflow), "unknown", 0, NULL, NULL, NULL);
+    }
+
+    ex_handler(sig);
+}
+#endif
+
 void ex_signal_reset(int sig) {
 #if defined(_WIN32) || defined(_WIN64)
     if (signal(sig, SIG_DFL) == SIG_ERR)
@@ -574,6 +590,7 @@ void ex_signal_reset(int sig) {
      * Make signal handlers persistent.
      */
     ex_sig_sa.sa_handler = SIG_DFL;
+    ex_sig_sa.sa_flags = 0;
     if (sigemptyset(&ex_sig_sa.sa_mask) != 0)
         fprintf(stderr, "Cannot setup handler for signal no %d\n", sig);
     else if (sigaction(sig, &ex_sig_sa, NULL) != 0)
@@ -606,10 +623,11 @@ void ex_signal(int sig, const char *ex) {
         ex_sig[i].ex = ex, ex_sig[i].sig = sig;
 #else
     /*
-     * Make signal handlers persistent.
+     * Make signal handlers persistent, and run on an alternate
+     * signal stack if the thread have one, needed to handle overflows.
      */
-    ex_sig_sa.sa_handler = ex_handler;
-    ex_sig_sa.sa_flags = SA_RESTART;
+    ex_sig_sa.sa_sigaction = ex_sig_handler;
+    ex_sig_sa.sa_flags = SA_RESTART | SA_SIGINFO | SA_ONSTACK;
     if (sigemptyset(&ex_sig_sa.sa_mask) != 0)
         fprintf(stderr, "Cannot setup handler for signal no %d (%s)\n",
                       sig, ex);
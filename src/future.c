@@ -12,14 +12,241 @@ Modified from https://gist.github.com/Geal/8f85e02561d101decf9a
 
 struct future_pool {
     raii_type type;
-    arrays_t jobs;
+    /* number of jobs spawned, `jobs` and `futures` indexed by job position */
+    size_t count;
+    rid_t *jobs;
     memory_t *scope;
     future *futures;
     raii_deque_t *queue;
 };
 
+/* Jobs queue of one pool worker, the coroutine Chase-Lev `deque`, any thread
+submits at `bottom`, owner takes newest from `bottom`, idle/waiting workers oldest from `top`. */
+typedef struct {
+    raii_deque_t *jobs;
+    thrd_t thread;
+} future_deque_t;
+
+/* In `coro.c`, pool worker jobs `deque`. */
+raii_deque_t *raii_deque_create(u32 size_hint);
+void raii_deque_push(raii_deque_t *q, void_t job);
+void_t raii_deque_pop(raii_deque_t *q);
+void_t raii_deque_steal(raii_deque_t *q);
+void raii_deque_free(raii_deque_t *q);
+
+static struct {
+    u32 count;
+    bool shutdown;
+    /* round robin counter, for next worker to receive job */
+    atomic_size_t next;
+    /* jobs submitted, not yet taken */
+    atomic_size_t pending;
+    atomic_size_t waiters;
+    mtx_t lock;
+    cnd_t wake;
+    future_deque_t *queues;
+} future_pool;
+/* `0` not running, `1` starting/stopping, `2` running */
+static atomic_size_t future_pool_state = 0;
+static bool future_pool_exit_set = false;
+/* workers set by `thrd_pool_workers`, for next pool start */
+static u32 future_pool_requested = 0;
+/* pool worker number, plus one, of current thread */
+thrd_static(u32, future_worker, 0)
+/* Objects every `thread/future` call takes, recycled by pool workers, and callers. */
+static raii_pool_t future_promises = RAII_POOL_INIT("promise", promise);
+static raii_pool_t future_futures = RAII_POOL_INIT("future", struct _future);
+static raii_pool_t future_workers = RAII_POOL_INIT("worker_t", worker_t);
+
+/* Take pending job for pool worker `self`, newest from own queue first,
+keeping nested waits depth first, otherwise oldest from all others. */
+static worker_t *future_pool_take(u32 self) {
+    worker_t *job;
+    u32 i;
+
+    if (atomic_load(&future_pool.pending) == 0)
+        return nullptr;
+
+    if ((job = raii_deque_pop(future_pool.queues[self].jobs)) != nullptr) {
+        atomic_fetch_sub(&future_pool.pending, 1);
+        return job;
+    }
+
+    for (i = 1; i < future_pool.count; i++) {
+        job = raii_deque_steal(future_pool.queues[(self + i) % future_pool.count].jobs);
+        if (job != nullptr) {
+            atomic_fetch_sub(&future_pool.pending, 1);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+/* Run `thread/future` job within current pool worker, restoring any outer job's
+`thrd_data` and `thrd_scope` state, if job started while waiting on another. */
+static void future_job_run(worker_t *f) {
+    memory_t *local = raii_init();
+    vectors_t outer = local->local;
+    raii_deque_t *queued = local->queued;
+    future_t threaded = local->threaded;
+    template_t res[1] = {0};
+    f->value->scope->err = nullptr;
+    local->queued = f->queue;
+    local->local = f->arg;
+
+    guard {
+        args_destructor_set(f->arg);
+        res->object = f->func((args_t)f->arg);
+        promise_set(f->value, res->object);
+    } guarded_exception(f->value);
+
+    local->local = outer;
+    local->queued = queued;
+    local->threaded = threaded;
+    f->type = RAII_ERR;
+    raii_pool_free(&future_workers, f);
+}
+
+static int future_pool_worker(void_t arg) {
+    u32 id = (u32)(uintptr_t)arg;
+    worker_t *job;
+
+    rpmalloc_init();
+    raii_init()->threading++;
+    *future_worker() = id + 1;
+    for (;;) {
+        if ((job = future_pool_take(id)) != nullptr) {
+            future_job_run(job);
+            continue;
+        }
+
+        mtx_lock(&future_pool.lock);
+        if (future_pool.shutdown && atomic_load(&future_pool.pending) == 0) {
+            mtx_unlock(&future_pool.lock);
+            break;
+        }
+
+        atomic_fetch_add(&future_pool.waiters, 1);
+        while (atomic_load(&future_pool.pending) == 0 && !future_pool.shutdown)
+            cnd_wait(&future_pool.wake, &future_pool.lock);
+
+        atomic_fetch_sub(&future_pool.waiters, 1);
+        mtx_unlock(&future_pool.lock);
+    }
+
+    raii_destroy();
+    raii_pool_flush();
+    rpmalloc_thread_finalize(1);
+    return 0;
+}
+
+/* Join first `started` workers, release every queue, and mark pool not running. */
+static void future_pool_stop(u32 started) {
+    u32 i;
+
+    mtx_lock(&future_pool.lock);
+    future_pool.shutdown = true;
+    cnd_broadcast(&future_pool.wake);
+    mtx_unlock(&future_pool.lock);
+    for (i = 0; i < started; i++)
+        thrd_join(future_pool.queues[i].thread, NULL);
+
+    for (i = 0; i < future_pool.count; i++)
+        raii_deque_free(future_pool.queues[i].jobs);
+
+    free(future_pool.queues);
+    future_pool.queues = nullptr;
+    mtx_destroy(&future_pool.lock);
+    cnd_destroy(&future_pool.wake);
+    atomic_store(&future_pool_state, 0);
+}
+
+static void future_pool_start(void) {
+    size_t state = 0;
+    u32 i;
+
+    if (atomic_load_explicit(&future_pool_state, memory_order_acquire) == 2)
+        return;
+
+    if (!atomic_compare_exchange_strong(&future_pool_state, &state, 1)) {
+        /* Another thread starting, or stopping it, after an failed start try again. */
+        while (atomic_load(&future_pool_state) == 1)
+            thrd_yield();
+
+        future_pool_start();
+        return;
+    }
+
+    future_pool.count = future_pool_requested > 0 ? future_pool_requested
+        : THRD_POOL_SIZE > 0 ? THRD_POOL_SIZE : (u32)thrd_cpu_count();
+    if (future_pool.count == 0)
+        future_pool.count = 1;
+
+    future_pool.shutdown = false;
+    atomic_init(&future_pool.next, 0);
+    atomic_init(&future_pool.pending, 0);
+    atomic_init(&future_pool.waiters, 0);
+    if (mtx_init(&future_pool.lock, mtx_plain) != thrd_success
+        || cnd_init(&future_pool.wake) != thrd_success)
+        raii_panic("Pool `mtx_init/cnd_init` failed!");
+
+    future_pool.queues = try_calloc(future_pool.count, sizeof(future_deque_t));
+    for (i = 0; i < future_pool.count; i++)
+        future_pool.queues[i].jobs = raii_deque_create(THRD_POOL_QUEUE);
+
+    for (i = 0; i < future_pool.count; i++) {
+        if (thrd_create(&future_pool.queues[i].thread, future_pool_worker, casting(i)) != thrd_success) {
+            /* Stop those already started, so next call can start pool again. */
+            future_pool_stop(i);
+            throw(future_error);
+        }
+    }
+
+    if (!future_pool_exit_set) {
+        future_pool_exit_set = true;
+        atexit(thrd_pool_shutdown);
+    }
+
+    atomic_store_explicit(&future_pool_state, 2, memory_order_release);
+}
+
+/* Submit job to current pool worker's own queue, otherwise next worker
+in round robin order, waking an parked worker. */
+static void future_pool_submit(worker_t *job) {
+    u32 self = *future_worker();
+    future_pool_start();
+    /* count first, so takers never see more jobs than `pending` */
+    atomic_fetch_add(&future_pool.pending, 1);
+    raii_deque_push(future_pool.queues[self
+        ? self - 1 : atomic_fetch_add(&future_pool.next, 1) % future_pool.count].jobs, job);
+    if (atomic_load(&future_pool.waiters) > 0) {
+        mtx_lock(&future_pool.lock);
+        cnd_signal(&future_pool.wake);
+        mtx_unlock(&future_pool.lock);
+    }
+}
+
+void thrd_pool_shutdown(void) {
+    size_t state = 2;
+
+    if (atomic_compare_exchange_strong(&future_pool_state, &state, 1))
+        future_pool_stop(future_pool.count);
+}
+
+RAII_INLINE void thrd_pool_workers(u32 count) {
+    future_pool_requested = count;
+}
+
+static void promise_free(void_t p) {
+    raii_pool_free(&future_promises, p);
+}
+
 promise *promise_create(memory_t *scope) {
-    promise *p = malloc_full(scope, sizeof(promise), free);
+    promise *p = raii_pool_alloc(&future_promises);
+    atomic_lock(&scope->promise_lock);
+    raii_deferred(scope, promise_free, p);
+    atomic_unlock(&scope->promise_lock);
     p->scope = scope;
     atomic_flag_clear(&p->mutex);
     atomic_flag_clear(&p->done);
@@ -30,6 +257,7 @@ promise *promise_create(memory_t *scope) {
 
 void promise_set(promise *p, void_t res) {
     atomic_lock(&p->mutex);
+    atomic_lock(&p->scope->promise_lock);
     p->result = (raii_values_t *)calloc_full(p->scope, 1, sizeof(raii_values_t), free);
     if (!is_empty(res)) {
         if (is_args(res) || is_vector(res)) {
@@ -40,6 +268,7 @@ void promise_set(promise *p, void_t res) {
             p->result->value.object = ((raii_values_t *)res)->value.object;
         }
     }
+    atomic_unlock(&p->scope->promise_lock);
     atomic_unlock(&p->mutex);
     atomic_flag_test_and_set(&p->done);
 }
@@ -54,8 +283,15 @@ void promise_erred(promise *p, ex_context_t err) {
 }
 
 static RAII_INLINE raii_values_t *promise_get(promise *p) {
-    while (!atomic_flag_load(&p->done))
-        thrd_yield();
+    worker_t *job;
+    while (!atomic_flag_load(&p->done)) {
+        /* Pool worker waiting on another job runs pending jobs meanwhile,
+        so nested waits can't tie up every worker. */
+        if (*future_worker() && (job = future_pool_take(*future_worker() - 1)) != nullptr)
+            future_job_run(job);
+        else
+            thrd_yield();
+    }
 
     return p->result;
 }
@@ -71,7 +307,7 @@ void promise_close(promise *p) {
 }
 
 future future_create(thrd_func_t start_routine) {
-	future f = try_malloc(sizeof(struct _future));
+	future f = raii_pool_alloc(&future_futures);
 	atomic_flag_clear(&f->started);
     f->is_pool = 0;
     f->func = (thrd_func_t)start_routine;
@@ -85,46 +321,20 @@ static void future_close(future f) {
         if (!f->is_pool)
             thrd_join(f->thread, NULL);
 
-        memset(f, 0, sizeof(*f));
-        free(f);
-    }
-}
-
-static int thrd_raii_wrapper(void_t arg) {
-    worker_t *f = (worker_t *)arg;
-    int err = 0;
-    template_t res[1] = {0};
-    f->value->scope->err = nullptr;
-    raii_init()->threading++;
-	raii_local()->queued = f->queue;
-	raii_local()->local = f->arg;
-    rpmalloc_init();
-
-    guard {
-        args_destructor_set(f->arg);
-        res->object = f->func((args_t)f->arg);
-    	promise_set(f->value, res->object);
-    } guarded_exception(f->value);
-
-    if (is_type(f, RAII_FUTURE_ARG)) {
-        memset(f, 0, sizeof(*f));
-        free(f);
+        f->type = RAII_ERR;
+        raii_pool_free(&future_futures, f);
     }
-
-    raii_destroy();
-    rpmalloc_thread_finalize(1);
-    thrd_exit(err);
-    return err;
 }
 
 static void thrd_start(future f, promise *value, void_t arg) {
-    worker_t *f_work = try_malloc(sizeof(worker_t));
+    worker_t *f_work = raii_pool_alloc(&future_workers);
     f_work->func = f->func;
     f_work->arg = arg;
     f_work->value = value;
+    f_work->queue = nullptr;
     f_work->type = RAII_FUTURE_ARG;
-    if (thrd_create(&f->thread, thrd_raii_wrapper, f_work) != thrd_success)
-        throw(future_error);
+    f->is_pool = 1;
+    future_pool_submit(f_work);
 }
 
 future thrd_async(thrd_func_t fn, size_t num_of_args, ...) {
@@ -157,7 +367,7 @@ RAII_INLINE future thrd_launch(thrd_func_t fn, void_t args) {
 template_t thrd_get(future f) {
     if (is_type(f, RAII_FUTURE) && !is_empty(f->value) && is_type(f->value, RAII_PROMISE)) {
         raii_values_t *r = promise_get(f->value);
-        if (thrd_join(f->thread, NULL) == thrd_success) {
+        if (f->is_pool || thrd_join(f->thread, NULL) == thrd_success) {
             if (!is_empty(f->value->scope->err))
                 raii_defer((func_t)thrd_delete, f);
             promise_close(f->value);
@@ -241,16 +451,19 @@ size_t thrd_cpu_count(void) {
 #endif
 
 void thrd_set_result(raii_values_t *r, int id) {
-    result_t *results = (result_t *)atomic_load_explicit(&gq_result.results, memory_order_acquire);
-    results[id]->result = (raii_values_t *)calloc_full(gq_result.scope, 1, sizeof(raii_values_t), free);
+    result_t result = raii_result_get((rid_t)id);
+    if (!is_type(result, RAII_VALUE))
+        return;
+
+    result->result = &result->value;
     if (r->is_arrayed || r->is_vectored) {
-        results[id]->result = r;
+        result->result = r;
     } else if (!is_zero(r->value.integer)) {
-        results[id]->result->value.object = r->value.object;
+        result->result->value.object = r->value.object;
     }
 
-    results[id]->is_ready = true;
-    atomic_store_explicit(&gq_result.results, results, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+    result->is_ready = true;
 }
 
 future_t thrd_scope(void) {
@@ -264,16 +477,18 @@ future_t thrd_scope(void) {
         if (raii_local()->threading)
             throw(logic_error);
 
-        queue = coro_pool_init(0);
+        /* already initialized by coroutine runtime, when `nullptr` */
+        if (is_empty(queue = coro_pool_init(0)))
+            queue = gq_result.queue;
     }
 
     scope = unique_init();
     pool = (future_t)try_calloc(1, sizeof(struct future_pool));
     pool->futures = nullptr;
+    pool->jobs = nullptr;
+    pool->count = 0;
     pool->scope = scope;
     pool->queue = queue;
-    pool->jobs = array_of(scope, 0);
-    array_deferred_set(pool->jobs, scope);
     pool->type = RAII_SPAWN;
     spawn->threaded = pool;
 
@@ -293,9 +508,13 @@ rid_t thrd_spawn(thrd_func_t fn, size_t num_of_args, ...) {
     future_t pool = scope->threaded;
     result_t result = raii_result_create();
     rid_t result_id = result->id;
+    size_t job = pool->count;
 
-    if (result_id % gq_result.queue_size == 0 || is_empty(pool->futures))
-        pool->futures = try_realloc(pool->futures, (result_id + gq_result.queue_size) * sizeof(pool->futures[0]));
+    /* grow by doubling, `result_id` slots are recycled, can't index by them */
+    if ((job & (job - 1)) == 0) {
+        pool->futures = try_realloc(pool->futures, (job ? job * 2 : 1) * sizeof(pool->futures[0]));
+        pool->jobs = try_realloc(pool->jobs, (job ? job * 2 : 1) * sizeof(pool->jobs[0]));
+    }
 
     promise *p = promise_create(pool->scope);
     future f = future_create(fn);
@@ -303,38 +522,66 @@ rid_t thrd_spawn(thrd_func_t fn, size_t num_of_args, ...) {
     f->value = p;
     f->id = result_id;
 
-    worker_t *f_work = try_malloc(sizeof(worker_t));
+    worker_t *f_work = raii_pool_alloc(&future_workers);
     f_work->func = f->func;
     f_work->arg = args;
     f_work->value = p;
-    f_work->queue = scope->queued;
+    f_work->queue = pool->queue;
     f_work->type = RAII_FUTURE_ARG;
 
-    $append_unsigned(pool->jobs, result_id);
-    pool->futures[result_id] = f;
-   // if (!is_empty(queue->local))
-       // thrd_add(f, queue, f_work, nil, nil);
-    //else
-    if (thrd_create(&f->thread, thrd_raii_wrapper, f_work) != thrd_success)
-        throw(future_error);
+    pool->jobs[job] = result_id;
+    pool->futures[job] = f;
+    pool->count++;
+    f->is_pool = 1;
+    future_pool_submit(f_work);
 
     return result_id;
 }
 
+static void_t thrd_for_chunk(args_t args) {
+    return ((range_func_t)(call_t)args[0].func)(args[1].long_long, args[2].long_long);
+}
+
+future_t thrd_for(range_func_t loop, intptr_t initial, intptr_t times) {
+    memory_t *local;
+    future_t outer, pool;
+    intptr_t start, chunks, grain, end = initial + times;
+
+    future_pool_start();
+    local = raii_init();
+    outer = local->threaded;
+    pool = thrd_scope();
+    chunks = (intptr_t)future_pool.count * THRD_FOR_CHUNKS;
+    grain = (times + chunks - 1) / chunks;
+    if (grain < THRD_FOR_GRAIN)
+        grain = THRD_FOR_GRAIN;
+
+    for (start = initial; start < end; start += grain)
+        thrd_spawn(thrd_for_chunk, 3, (void_t)loop, casting(start),
+                   casting(end - start > grain ? start + grain : end));
+
+    /* leave caller's own `thrd_scope`, if any, current */
+    local->threaded = outer;
+    return pool;
+}
+
 future_t thrd_sync(future_t pool) {
     if (!is_type(pool, RAII_SPAWN))
         throw(logic_error);
 
-    int i;
-    foreach(num in pool->jobs) {
-        i = num.integer;
-        raii_values_t *result = promise_get(pool->futures[i]->value);
-        thrd_set_result(result, i);
-        future_close(pool->futures[i]);
-        if (!is_empty(pool->futures[i]->value->scope->err))
-            raii_defer((func_t)thrd_delete, pool->futures[i]);
+    size_t i;
+    promise *p;
+    raii_values_t *result;
+    for (i = 0; i < pool->count; i++) {
+        p = pool->futures[i]->value;
+        result = promise_get(p);
+        /* erred job has no result, `promise_close` rethrows it's error */
+        if (!is_empty(result))
+            thrd_set_result(result, (int)pool->jobs[i]);
 
-        promise_close(pool->futures[i]->value);
+        future_close(pool->futures[i]);
+        pool->futures[i] = nullptr;
+        promise_close(p);
     }
 
     raii_deferred_clean();
@@ -343,21 +590,29 @@ future_t thrd_sync(future_t pool) {
 }
 
 void thrd_then(result_func_t callback, future_t iter, void_t result) {
-    int i;
-    result_t *results = (result_t *)atomic_load_explicit(&gq_result.results, memory_order_relaxed);
-    foreach(num in iter->jobs) {
-        i = num.integer;
-        if (results[i]->is_ready)
-            result = callback(result, i, results[i]->result->value.object);
+    result_t value;
+    size_t i;
+    for (i = 0; i < iter->count; i++) {
+        value = raii_result_get(iter->jobs[i]);
+        if (value->is_ready)
+            result = callback(result, iter->jobs[i], value->result->value.object);
     }
 }
 
 void thrd_destroy(future_t f) {
     if (is_type(f, RAII_SPAWN)) {
         memory_t *scope = f->scope;
+        size_t i;
         f->type = RAII_ERR;
+        for (i = 0; i < f->count; i++) {
+            raii_result_free(f->jobs[i]);
+            if (!is_empty(f->futures[i]))
+                future_close(f->futures[i]);
+        }
+
         raii_delete(scope);
         free(f->futures);
+        free(f->jobs);
         free(f);
     }
 }
@@ -368,15 +623,14 @@ void thrd_delete(future f) {
         if (!is_empty(f->scope))
             raii_delete(f->scope);
 
-        free(f);
+        raii_pool_free(&future_futures, f);
     }
 }
 
 RAII_INLINE bool thrd_is_finish(future_t f) {
     size_t i;
-    foreach(num in f->jobs) {
-        i = num.max_size;
-        if (!thrd_is_done(f->futures[i]))
+    for (i = 0; i < f->count; i++) {
+        if (!is_empty(f->futures[i]) && !thrd_is_done(f->futures[i]))
             return false;
     }
 
@@ -16,6 +16,13 @@ struct hash_pair_s {
     template_t *extended;
 };
 
+/* Pair and it's `extended` value, taken from pool as one object. */
+typedef struct {
+    hash_pair_t pair;
+    template_t value;
+} hash_record_t;
+static raii_pool_t hash_records = RAII_POOL_INIT("hash_pair_t", hash_record_t);
+
 make_atomic(hash_pair_t, atomic_hash_pair_t)
 struct hash_s {
     raii_type type;
@@ -76,10 +83,9 @@ void pair_free(hash_pair_t *pair) {
         }
 
         pair->type = RAII_ERR;
-        free(pair->extended);
-        free(pair);
+        raii_pool_free(&hash_records, pair);
     } else if (!is_empty(pair) && is_type(pair, RAII_NULL)) {
-        free(pair);
+        raii_pool_free(&hash_records, pair);
     }
 }
 
@@ -110,7 +116,8 @@ void hash_free(hash_t *htable) {
 
 static RAII_INLINE void hash_grow(hash_t *htable) {
     u32 i, old_capacity;
-    hash_pair_t **old_buckets;
+    size_t idx;
+    hash_pair_t **old_buckets, **new_buckets;
     hash_pair_t *crt_pair;
 
     atomic_thread_fence(memory_order_acquire);
@@ -122,15 +129,25 @@ static RAII_INLINE void hash_grow(hash_t *htable) {
     old_buckets = (hash_pair_t **)atomic_load_explicit(&htable->buckets, memory_order_consume);
     atomic_init(&htable->capacity, (size_t)new_capacity_64);
     atomic_init(&htable->size, 0);
-    atomic_init(&htable->buckets, try_calloc(1, new_capacity_64 * sizeof(*(old_buckets))));
+    new_buckets = try_calloc(1, new_capacity_64 * sizeof(*(old_buckets)));
+    atomic_init(&htable->buckets, new_buckets);
+    /* Move pairs as is, keys and values keep there addresses, only tombstones are dropped. */
     for (i = 0; i < old_capacity; i++) {
         crt_pair = old_buckets[i];
-        if (!is_empty(crt_pair) && !hash_is_tombstone(htable, i)) {
-            hash_operation(htable, crt_pair->key, crt_pair->value, crt_pair->type);
-            htable->val_ops.free(crt_pair->value);
-            htable->key_ops.free(crt_pair->key);
+        if (is_empty(crt_pair))
+            continue;
+
+        if (is_empty(crt_pair->key) && is_empty(crt_pair->value) && 0 == crt_pair->hash) {
             pair_free(crt_pair);
+            continue;
         }
+
+        idx = crt_pair->hash % (size_t)new_capacity_64;
+        while (!is_empty(new_buckets[idx]))
+            htable->probing(htable, &idx);
+
+        new_buckets[idx] = crt_pair;
+        atomic_fetch_add(&htable->size, 1);
     }
 
     free(old_buckets);
@@ -138,7 +155,7 @@ static RAII_INLINE void hash_grow(hash_t *htable) {
 }
 
 static RAII_INLINE bool hash_should_grow(hash_t *htable) {
-    return (atomic_load(&htable->size) / atomic_load(&htable->capacity)) > (htable->overriden ? .95 : HASH_LOAD_FACTOR);
+    return ((double)atomic_load(&htable->size) / atomic_load(&htable->capacity)) > (htable->overriden ? .95 : HASH_LOAD_FACTOR);
 }
 
 hash_pair_t *hash_operation(hash_t *hash, const_t key, const_t value, raii_type op) {
@@ -170,7 +187,6 @@ hash_pair_t *hash_operation(hash_t *hash, const_t key, const_t value, raii_type
         } else {
             // Update the existing value
             // Free the old values
-            free(buckets[idx]->extended);
             if (buckets[idx]->type == RAII_PTR)
                 hash->key_ops.free(buckets[idx]->value);
 
@@ -179,7 +195,8 @@ hash_pair_t *hash_operation(hash_t *hash, const_t key, const_t value, raii_type
             if (op == RAII_STRING && simd_strlen((string)value) > (sizeof(template_t) - 1))
                 buckets[idx]->type = RAII_CONST_CHAR;
 
-            buckets[idx]->extended = value_create(hash->val_ops.cp(value, hash->val_ops.arg), op);
+            memset(buckets[idx]->extended, 0, sizeof(template_t));
+            value_init(buckets[idx]->extended, hash->val_ops.cp(value, hash->val_ops.arg), op);
             buckets[idx]->value = buckets[idx]->extended;
             if (op == RAII_PTR)
                 buckets[idx]->value = buckets[idx]->extended->object;
@@ -365,7 +382,6 @@ void hash_delete(hash_t *htable, const_t key) {
 
     hash_pair_t **buckets = (hash_pair_t **)atomic_load_explicit(&htable->buckets, memory_order_acquire);
     atomic_thread_fence(memory_order_seq_cst);
-    free(buckets[idx]->extended);
     htable->key_ops.free(buckets[idx]->key);
     if (buckets[idx]->type == RAII_PTR)
         htable->key_ops.free(buckets[idx]->value);
@@ -432,12 +448,13 @@ static size_t hash_getidx(hash_t *htable, size_t idx, uint32_t hash_val,
 }
 
 hash_pair_t *pair_create(uint32_t hash, const_t key, const_t value, raii_type op) {
-    hash_pair_t *p = try_calloc(1, sizeof(hash_pair_t));
+    hash_record_t *record = raii_pool_alloc(&hash_records);
+    hash_pair_t *p = &record->pair;
     p->type = op;
     if (op == RAII_STRING && simd_strlen((string)value) > (sizeof(template_t) - 1))
         p->type = RAII_CONST_CHAR;
 
-    p->extended = value_create(value, op);
+    p->extended = value_init(&record->value, value, op);
     p->hash = hash;
     p->value = p->extended;
     if (op == RAII_PTR)
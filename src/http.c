@@ -44,6 +44,7 @@ struct cookie_s {
 	string expiries;
 	string domain;
 	string sameSite;
+	cookie_t *next;
 };
 
 struct response_s {
@@ -69,6 +70,7 @@ struct form_data_s {
 	string disposition;
 	string type;
 	string encoding;
+	form_data_t *next;
 };
 
 struct http_s {
@@ -108,6 +110,10 @@ struct http_s {
 	/* Parser, `request/response` staging allocations,
 	WILL be freed at exit, and before `parse_http` execution. */
 	arrays_t garbage;
+	/* Parsed `cookie_t` and `form_data_t` records, linked by `next`,
+	returned to there pools along with `garbage`. */
+	cookie_t *cookie_list;
+	form_data_t *form_list;
 	/* The current headers
 	and `response` headers to send */
 	hash_http_t *headers;
@@ -119,11 +125,26 @@ struct http_s {
 	hash_http_t *sessions;
 };
 
+static raii_pool_t http_cookies = RAII_POOL_INIT("cookie_t", cookie_t);
+static raii_pool_t http_forms = RAII_POOL_INIT("form_data_t", form_data_t);
+
 static void http_clear(http_t *this) {
+	cookie_t *cookie;
+	form_data_t *form;
 	foreach(arr in this->garbage) {
 		free(arr.object);
 	}
 
+	while ((cookie = this->cookie_list) != nullptr) {
+		this->cookie_list = cookie->next;
+		raii_pool_free(&http_cookies, cookie);
+	}
+
+	while ((form = this->form_list) != nullptr) {
+		this->form_list = form->next;
+		raii_pool_free(&http_forms, form);
+	}
+
 	array_delete(this->garbage);
 	this->garbage = nullptr;
 }
@@ -318,11 +339,9 @@ static void parse_multipart(http_t *this) {
 				boundaries = str_split_ex(nullptr, boundary[x], LFLF, &pieces);
 				$append(this->garbage, boundaries);
 				if (pieces > 1) {
-					multipart = calloc(1, sizeof(form_data_t));
-					if (is_empty(multipart))
-						break;
-
-					$append(this->garbage, multipart);
+					multipart = raii_pool_alloc(&http_forms);
+					multipart->next = this->form_list;
+					this->form_list = multipart;
 					multipart->body = trim(boundaries[1]);
 					// Calculate each multipart body size by memory region used
 					size_t headsize = ((uintptr_t)boundaries[1] - (uintptr_t)boundaries[0]);
@@ -451,8 +470,9 @@ void parse_http(http_parser_type action, http_t *this, string headers) {
 						this->sessions = hash_create_ex(SCRAPE_SIZE);
 
 					is_cookie_set = true;
-					cookie_t *cookie = try_calloc(1, sizeof(cookie_t));
-					$append(this->garbage, cookie);
+					cookie_t *cookie = raii_pool_alloc(&http_cookies);
+					cookie->next = this->cookie_list;
+					this->cookie_list = cookie;
 					if (is_str_in(value, "Secure"))
 						cookie->secure = true;
 
@@ -547,6 +567,8 @@ http_t *http_for(string hostname, double protocol) {
     this->names = nullptr;
     this->cookies = nullptr;
     this->garbage = nullptr;
+    this->cookie_list = nullptr;
+    this->form_list = nullptr;
     this->sessions = nullptr;
     this->dispositions = nullptr;
     this->is_multipart = false;
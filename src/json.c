@@ -435,6 +435,46 @@ string json_for(string_t desc, ...) {
     return json_serialize(json_array_get_wrapping_value(value_array), false);
 }
 
+#if !defined(_WIN32)
+/* Inside coroutines, file is read with `coro_fs_*` calls, not blocking the worker thread. */
+string json_read_file(string_t filename) {
+    struct stat st;
+    size_t size_read = 0;
+    ssize_t n = 0;
+    string file_contents;
+    int fd = coro_fs_open(filename, O_RDONLY, 0);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    if (coro_fs_fstat(fd, &st) < 0 || st.st_size < 0) {
+        coro_fs_close(fd);
+        return nullptr;
+    }
+
+    file_contents = (string)malloc(sizeof(char) * ((size_t)st.st_size + 1));
+    if (!file_contents) {
+        coro_fs_close(fd);
+        return nullptr;
+    }
+
+    while (size_read < (size_t)st.st_size
+           && (n = coro_fs_read(fd, file_contents + size_read, (size_t)st.st_size - size_read, size_read)) > 0)
+        size_read += n;
+
+    coro_fs_close(fd);
+    if (size_read == 0 || n < 0) {
+        free(file_contents);
+        return nullptr;
+    }
+
+    file_contents[size_read] = '\0';
+    deferring(free, file_contents);
+
+    return file_contents;
+}
+#else
 string json_read_file(string_t filename) {
     FILE *fp = fopen(filename, "r");
     size_t size_to_read = 0;
@@ -474,3 +514,4 @@ string json_read_file(string_t filename) {
 
     return file_contents;
 }
+#endif
@@ -32,9 +32,11 @@ struct map_iterator_s {
     map_item_t *item;
 };
 
+static raii_pool_t map_items = RAII_POOL_INIT("map_item_t", map_item_t);
+
 static void map_add_pair(map_t hash, hash_pair_t *kv) {
     map_item_t *item;
-    item = (map_item_t *)try_calloc(1, sizeof(map_item_t));
+    item = (map_item_t *)raii_pool_alloc(&map_items);
     if (hash->item_type == RAII_MAP_ARR)
         item->indic = hash->indices;
     else
@@ -127,7 +129,7 @@ static void slice_free(slice_t array) {
             while (each->head) {
                 next = each->head->next;
                 tmp = each->head;
-                ZE_FREE(tmp);
+                raii_pool_free(&map_items, tmp);
                 each->head = next;
             }
             ZE_FREE(each);
@@ -139,7 +141,7 @@ static void slice_free(slice_t array) {
 
 static void slice_set(slice_t array, hash_pair_t *kv, int64_t index) {
     if (!is_empty(kv)) {
-        struct map_item_s *item = (struct map_item_s *)try_calloc(1, sizeof(struct map_item_s));
+        struct map_item_s *item = (struct map_item_s *)raii_pool_alloc(&map_items);
         item->indic = index;
         item->key = hash_pair_key(kv);
         item->value = hash_pair_value(kv);
@@ -212,7 +214,7 @@ RAII_INLINE void_t slice_delete(slice_t hash, int64_t index) {
 }
 
 map_t map_create(void) {
-    map_t hash = (map_t)try_malloc(sizeof(struct map_s));
+    map_t hash = (map_t)try_calloc(1, sizeof(struct map_s));
     hash->started = false;
     hash->dict = hash_create_ex(256);
     hash->type = RAII_MAP_STRUCT;
@@ -297,7 +299,7 @@ void map_free(map_t hash) {
         hash->type = RAII_ERR;
         while (hash->head) {
             next = hash->head->next;
-            ZE_FREE(hash->head);
+            raii_pool_free(&map_items, hash->head);
             hash->head = next;
         }
 
@@ -340,7 +342,7 @@ template_t map_pop(map_t hash) {
         hash->head = nullptr;
 
     value = item->value;
-    ZE_FREE(item);
+    raii_pool_free(&map_items, item);
 
     return value;
 }
@@ -353,7 +355,7 @@ u32 map_shift(map_t hash, void_t value) {
     if (!hash)
         return;
 
-    item = (map_item_t *)try_calloc(1, sizeof(map_item_t));
+    item = (map_item_t *)raii_pool_alloc(&map_items);
     item->type = RAII_MAP_VALUE;
     item->prev = nullptr;
     item->next = hash->head;
@@ -394,7 +396,7 @@ template_t map_unshift(map_t hash) {
         hash->tail = nullptr;
 
     value = item->value;
-    ZE_FREE(item);
+    raii_pool_free(&map_items, item);
 
     return value;
 }
@@ -406,6 +408,23 @@ RAII_INLINE size_t map_count(map_t hash) {
     return 0;
 }
 
+/* Remove `item` from both, the ordered list, and dictionary. */
+static void map_unlink(map_t hash, map_item_t *item) {
+    hash_delete(hash->dict, item->key);
+    if (item->prev)
+        item->prev->next = item->next;
+    else
+        hash->head = item->next;
+
+    if (item->next)
+        item->next->prev = item->prev;
+    else
+        hash->tail = item->prev;
+
+    raii_pool_free(&map_items, item);
+    hash->length--;
+}
+
 void_t map_remove(map_t hash, void_t value) {
     map_item_t *item;
 
@@ -414,20 +433,7 @@ void_t map_remove(map_t hash, void_t value) {
 
     for (item = hash->head; item != nullptr; item = item->next) {
         if (is_equal(item->value.object, value)) {
-            hash_delete(hash->dict, item->key);
-            if (item->prev)
-                item->prev->next = item->next;
-            else
-                hash->head = item->next;
-
-            if (item->next)
-                item->next->prev = item->prev;
-            else
-                hash->tail = item->prev;
-
-            ZE_FREE(item);
-            hash->length--;
-
+            map_unlink(hash, item);
             return value;
         }
     }
@@ -435,11 +441,24 @@ void_t map_remove(map_t hash, void_t value) {
     return nullptr;
 }
 
-RAII_INLINE void_t map_delete(map_t hash, string_t key) {
-    if (!hash)
+void_t map_delete(map_t hash, string_t key) {
+    map_item_t *item;
+    hash_pair_t *kv;
+    void_t value;
+
+    if (!hash || is_empty(kv = hash_get_pair(hash->dict, key)))
         return nullptr;
 
-    return map_remove(hash, hash_get(hash->dict, key));
+    /* Items share the dictionary's copy of key, match by it's address. */
+    for (item = hash->head; item != nullptr; item = item->next) {
+        if (item->key == hash_pair_key(kv)) {
+            value = item->value.object;
+            map_unlink(hash, item);
+            return value;
+        }
+    }
+
+    return nullptr;
 }
 
 RAII_INLINE template_t map_get(map_t hash, string_t key) {
@@ -550,7 +569,7 @@ map_iter_t *iter_remove(map_iter_t *iterator) {
             iterator->hash->length--;
 
             iterator->item = iterator->forward ? item->next : item->prev;
-            ZE_FREE(item);
+            raii_pool_free(&map_items, item);
             if (iterator->item) {
                 return iterator;
             } else {
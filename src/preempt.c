@@ -1,73 +1,77 @@
 /*
  * Modified from https://github.com/sysprog21/concurrent-programs/blob/master/preempt_sched/task_sched.c
  *
- * TODO: Preemptive multitasking in userspace based on SIGALRM signal or SetTimer under Windows,
- * simulating an OS timer interrupt.
+ * Preemptive multitasking in userspace based on per thread timers delivering `SIGALRM`,
+ * or SetTimer under Windows, simulating an OS timer interrupt.
  *
- * Execution of each coroutine can be preempted by SetTimer/SIGALRM signal,
- * each coroutine is an execution context, which can do a voluntary scheduling or be preempted by a timer,
- * and in that case nonvoluntary scheduling occurs.
+ * Each worker thread gets it's own `timer_create()` timer, counting the thread's CPU time,
+ * and delivered with `SIGEV_THREAD_ID` to that thread only. The signal handler only
+ * records the time slice expired, the coroutine is switched back to the scheduler
+ * at the next safe point, `preempt_check()` or the last `preempt_enable()`, also
+ * called by `malloc_local/calloc_local` and `raii_defer/deferring`, after they are done.
+ * Switching from the handler itself, could interrupt `malloc` or an held lock.
+ * An coroutine reaching none of these, say an tight loop, is never switched.
  *
- * The default time slice is 10ms, that means that each 10ms SIGALRM/SetTimer fires and
- * next context is scheduled by round robin algorithm.
+ * Where per thread timers are not available, an single process wide timer is used,
+ * every expiration then counts for all workers.
+ *
+ * The default time slice is 10ms, `CORO_PREEMPT_USECS`.
  */
 #include "raii.h"
 
-#ifdef _WIN32
-static CRITICAL_SECTION signal_ctrl = {0};
-static RAII_INLINE void signal_block(void) {
-    EnterCriticalSection(&signal_ctrl);
-}
-
-static RAII_INLINE void signal_unblock(void) {
-    LeaveCriticalSection(&signal_ctrl);
-}
-#else
-static sigset_t signal_ctrl;
-static RAII_INLINE void signal_block(void) {
-    sigset_t block_set;
-    sigfillset(&block_set);
-    sigdelset(&block_set, SIGINT);
-    sigprocmask(SIG_BLOCK, &block_set, &signal_ctrl);
-}
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#   ifndef sigev_notify_thread_id
+#       define sigev_notify_thread_id _sigev_un._tid
+#   endif
+#   define PREEMPT_PER_THREAD 1
+#endif
 
-static RAII_INLINE void signal_unblock(void) {
-    sigprocmask(SIG_SETMASK, &signal_ctrl, NULL);
-}
+typedef struct {
+    /* `preempt_usecs` the timer was last armed with */
+    u32 usecs;
+    bool armed;
+    /* nested `preempt_disable()` count */
+    volatile sig_atomic_t disabled;
+    /* time slice expirations, since `running` started */
+    volatile sig_atomic_t ticks;
+    /* `preempt_epoch` when `running` started, process wide timer only */
+    size_t epoch;
+    /* coroutine the scheduler switched to, `nullptr` while in scheduler */
+    routine_t *volatile running;
+#if defined(PREEMPT_PER_THREAD)
+    timer_t timer;
 #endif
+} preempt_t;
+thrd_static(preempt_t, preempt, nullptr)
 
-static volatile sig_atomic_t preempt_count = 0;
-static void schedule(void) {
-}
+void preempt_slice(routine_t *co);
 
-RAII_INLINE void preempt_disable(void) {
-    preempt_count++;
-}
+static volatile u32 preempt_usecs = 0;
+static volatile bool preempt_installed = false;
+static atomic_size_t preempt_epoch = 0;
+static atomic_size_t preempt_ticks = 0;
+static atomic_size_t preempt_switched = 0;
+static atomic_size_t preempt_overruns = 0;
+static atomic_size_t preempt_deferred = 0;
 
-RAII_INLINE void preempt_enable(void) {
-    preempt_count--;
+/* Number of time slice expirations, since current coroutine started. */
+static RAII_INLINE size_t preempt_elapsed(preempt_t *p) {
+#if defined(PREEMPT_PER_THREAD)
+    return (size_t)p->ticks;
+#else
+    return atomic_load_explicit(&preempt_epoch, memory_order_relaxed) - p->epoch;
+#endif
 }
 
 #ifdef _WIN32
 static UINT TimerId;
 static uintptr_t hThreadId;
-static VOID CALLBACK preempt_handler(HWND hWnd, UINT nMsg, UINT nIDEvent, DWORD dwTime)
-#else
-static void preempt_handler(int signo, siginfo_t *info)
-#endif
-{
-    if (preempt_count) /* once preemption is disabled */
-        return;
-
-    signal_block();
-    /* We can schedule directly from sighandler because Linux kernel cares only
-     * about proper sigreturn frame in the stack.
-     */
-    schedule();
-    signal_unblock();
+static VOID CALLBACK preempt_handler(HWND hWnd, UINT nMsg, UINT nIDEvent, DWORD dwTime) {
+    atomic_fetch_add(&preempt_epoch, 1);
+    atomic_fetch_add(&preempt_ticks, 1);
 }
 
-#ifdef _WIN32
 static int preempt_thread(void *args) {
     u32 ms = *(u32 *)args;
     MSG Msg;
@@ -77,44 +81,198 @@ static int preempt_thread(void *args) {
         while (GetMessage(&Msg, NULL, 0, 0))
             DispatchMessage(&Msg);
 
-    DeleteCriticalSection(&signal_ctrl);
     return TimerId ? 0 : 16;
 }
 
+static void preempt_arm(preempt_t *p) {
+    p->usecs = preempt_usecs;
+}
+
 void preempt_init(u32 usecs) {
-    InitializeCriticalSection(&signal_ctrl);
-    hThreadId = _beginthread((_beginthread_proc_type)preempt_thread, 0, &usecs);
+    static u32 ms;
+    preempt_usecs = usecs ? usecs : CORO_PREEMPT_USECS;
+    ms = preempt_usecs < 1000 ? 1 : preempt_usecs / 1000;
+    hThreadId = _beginthread((_beginthread_proc_type)preempt_thread, 0, &ms);
+    preempt_slice(preempt()->running);
 }
 
 void preempt_stop(void) {
     int exit = KillTimer(NULL, TimerId);
+    preempt_usecs = 0;
     PostQuitMessage(exit ? 0 : GetLastError());
 }
 #else
+static void preempt_handler(int signo, siginfo_t *info, void_t context) {
+#if defined(PREEMPT_PER_THREAD)
+    preempt_t *p;
+    if (info->si_code != SI_TIMER || is_empty(p = (preempt_t *)info->si_value.sival_ptr))
+        return;
+
+    /* Idle scheduler time isn't any coroutine's time slice. */
+    if (is_empty(p->running))
+        return;
+
+    atomic_fetch_add(&preempt_ticks, 1);
+    if (p->disabled)
+        atomic_fetch_add(&preempt_deferred, 1);
+
+    if (++p->ticks == 2)
+        atomic_fetch_add(&preempt_overruns, 1);
+#else
+    atomic_fetch_add(&preempt_epoch, 1);
+    atomic_fetch_add(&preempt_ticks, 1);
+#endif
+}
+
+/* (Re)arm or release the calling worker timer, to match `preempt_usecs`. */
+static void preempt_arm(preempt_t *p) {
+#if defined(PREEMPT_PER_THREAD)
+    struct sigevent sev;
+    struct itimerspec spec;
+
+    if (p->armed) {
+        timer_delete(p->timer);
+        p->armed = false;
+    }
+
+    p->usecs = preempt_usecs;
+    if (!p->usecs)
+        return;
+
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGALRM;
+    sev.sigev_value.sival_ptr = p;
+    sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &p->timer) < 0) {
+        RAII_LOG("Error: `timer_create`");
+        return;
+    }
+
+    spec.it_value.tv_sec = p->usecs / 1000000;
+    spec.it_value.tv_nsec = (p->usecs % 1000000) * 1000;
+    spec.it_interval = spec.it_value;
+    if (timer_settime(p->timer, 0, &spec, nullptr) < 0) {
+        RAII_LOG("Error: `timer_settime`");
+        timer_delete(p->timer);
+        return;
+    }
+
+    p->armed = true;
+#else
+    p->usecs = preempt_usecs;
+#endif
+}
+
 void preempt_init(u32 usecs) {
+    struct sigaction sa;
+#if !defined(PREEMPT_PER_THREAD)
     struct itimerval timer;
-    struct sigaction sa = {
-        .sa_handler = (void (*)(int))preempt_handler,
-        .sa_flags = SA_SIGINFO,
-    };
-    sigfillset(&sa.sa_mask);
-    sigaction(SIGALRM, &sa, NULL);
-
-    /* Configure the timer to expire after `usecs` msec... */
-    timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = usecs * 1000;
-    /* ... and every `usecs` msec after that. */
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = usecs * 1000;
+#endif
+
+    if (!preempt_installed) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = (void (*)(int, siginfo_t *, void_t))preempt_handler;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigfillset(&sa.sa_mask);
+        /* Stays installed after `preempt_stop()`, expirations may still be pending. */
+        sigaction(SIGALRM, &sa, NULL);
+        preempt_installed = true;
+    }
+
+    preempt_usecs = usecs ? usecs : CORO_PREEMPT_USECS;
+#if !defined(PREEMPT_PER_THREAD)
+    /* Configure the timer to expire after `usecs` microseconds... */
+    timer.it_value.tv_sec = preempt_usecs / 1000000;
+    timer.it_value.tv_usec = preempt_usecs % 1000000;
+    /* ... and every `usecs` microseconds after that. */
+    timer.it_interval = timer.it_value;
     setitimer(ITIMER_REAL, &timer, NULL);
+#endif
+
+    /* Other workers arm their own timer, on their next time slice. */
+    preempt_slice(preempt()->running);
 }
 
 void preempt_stop(void) {
+#if !defined(PREEMPT_PER_THREAD)
     struct itimerval timer;
     timer.it_value.tv_sec = 0;
     timer.it_value.tv_usec = 0;
     timer.it_interval.tv_sec = 0;
     timer.it_interval.tv_usec = 0;
     setitimer(ITIMER_REAL, &timer, NULL);
+#endif
+
+    preempt_usecs = 0;
+    preempt_arm(preempt());
 }
 #endif
+
+void preempt_slice(routine_t *co) {
+    preempt_t *p = preempt();
+    if (p->usecs != preempt_usecs)
+        preempt_arm(p);
+
+    p->running = nullptr;
+    p->ticks = 0;
+    p->epoch = atomic_load_explicit(&preempt_epoch, memory_order_relaxed);
+    p->running = co;
+}
+
+void preempt_detach(void) {
+    preempt_t *p = preempt();
+#if defined(PREEMPT_PER_THREAD)
+    if (p->armed) {
+        timer_delete(p->timer);
+        p->armed = false;
+    }
+#endif
+
+    p->usecs = 0;
+    p->running = nullptr;
+}
+
+RAII_INLINE void preempt_disable(void) {
+    preempt()->disabled++;
+}
+
+RAII_INLINE void preempt_enable(void) {
+    if (--preempt()->disabled == 0)
+        preempt_check();
+}
+
+bool preempt_check(void) {
+    preempt_t *p;
+    size_t elapsed;
+
+    if (!preempt_usecs)
+        return false;
+
+    p = preempt();
+    elapsed = preempt_elapsed(p);
+    if (elapsed == 0 || p->disabled || is_empty(p->running))
+        return false;
+
+    if (elapsed > 1) {
+#if !defined(PREEMPT_PER_THREAD)
+        atomic_fetch_add(&preempt_overruns, 1);
+#endif
+        RAII_INFO("Coroutine %s overran time slice, by %zu expirations"CLR_LN,
+                  coro_get_name(), elapsed - 1);
+    }
+
+    atomic_fetch_add(&preempt_switched, 1);
+    yield();
+    return true;
+}
+
+preempt_stats_t preempt_stats(void) {
+    preempt_stats_t stats;
+    stats.ticks = atomic_load(&preempt_ticks);
+    stats.preempted = atomic_load(&preempt_switched);
+    stats.overruns = atomic_load(&preempt_overruns);
+    stats.deferred = atomic_load(&preempt_deferred);
+
+    return stats;
+}
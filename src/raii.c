@@ -84,8 +84,11 @@ RAII_INLINE uint64_t get_timer(void) {
     return lapse;
 }
 
-template_t *value_create(const_t data, raii_type op) {
-    template_t *value = try_calloc(1, sizeof(template_t));
+RAII_INLINE template_t *value_create(const_t data, raii_type op) {
+    return value_init(try_calloc(1, sizeof(template_t)), data, op);
+}
+
+template_t *value_init(template_t *value, const_t data, raii_type op) {
     size_t slen;
     string text;
 
@@ -143,8 +146,58 @@ template_t *value_create(const_t data, raii_type op) {
     return value;
 }
 
+static _result_t raii_result_stale[1] = {{RAII_ERR}};
+
+/* Return page holding slot `index`, allocating it if first use. */
+static result_t raii_result_page(size_t index) {
+    atomic_result_t *slot = &gq_result.results[index / RAII_RESULT_PAGE];
+    result_t expected = nullptr, page = (result_t)atomic_load_explicit(slot, memory_order_acquire);
+    if (is_empty(page)) {
+        page = (result_t)try_calloc(RAII_RESULT_PAGE, sizeof(_result_t));
+        if (!atomic_compare_exchange_strong(slot, &expected, page)) {
+            free(page);
+            page = expected;
+        }
+    }
+
+    return page;
+}
+
+static RAII_INLINE result_t raii_result_slot(size_t index) {
+    result_t page = (result_t)atomic_load_explicit(&gq_result.results[index / RAII_RESULT_PAGE], memory_order_acquire);
+    return page + (index % RAII_RESULT_PAGE);
+}
+
+/* Take oldest recycled slot, once `RAII_RESULT_REUSE` are waiting, or no new slots left. */
+static result_t raii_result_recycled(void) {
+    result_t result = nullptr;
+    if (atomic_load_explicit(&gq_result.result_free, memory_order_relaxed) < RAII_RESULT_REUSE
+        && atomic_load_explicit(&gq_result.result_id_generate, memory_order_relaxed) < RAII_RESULT_LIMIT)
+        return nullptr;
+
+    atomic_lock(&gq_result.result_lock);
+    if (gq_result.result_head != 0) {
+        result = raii_result_slot(gq_result.result_head - 1);
+        if ((gq_result.result_head = result->next) == 0)
+            gq_result.result_tail = 0;
+
+        atomic_fetch_sub(&gq_result.result_free, 1);
+    }
+    atomic_unlock(&gq_result.result_lock);
+
+    return result;
+}
+
 RAII_INLINE result_t raii_result_get(rid_t id) {
-    return (result_t)atomic_load_explicit(&gq_result.results[id], memory_order_relaxed);
+    result_t result;
+    size_t index = RAII_RESULT_INDEX(id);
+    if (index < atomic_load_explicit(&gq_result.result_id_generate, memory_order_acquire)) {
+        result = raii_result_slot(index);
+        if (result->id == id)
+            return result;
+    }
+
+    return raii_result_stale;
 }
 
 RAII_INLINE bool result_is_ready(rid_t id) {
@@ -152,22 +205,62 @@ RAII_INLINE bool result_is_ready(rid_t id) {
 }
 
 result_t raii_result_create(void) {
-    result_t result, *results;
-    size_t id = atomic_fetch_add(&gq_result.result_id_generate, 1);
-    result = (result_t)malloc_full(gq_result.scope, sizeof(struct result_data), free);
-    results = (result_t *)atomic_load_explicit(&gq_result.results, memory_order_acquire);
-    if (id % gq_result.queue_size == 0 || is_empty(results))
-        results = try_realloc(results, (id + gq_result.queue_size) * sizeof(results[0]));
+    size_t index;
+    result_t result = raii_result_recycled();
+    if (is_empty(result)) {
+        index = atomic_fetch_add(&gq_result.result_id_generate, 1);
+        if (index >= RAII_RESULT_LIMIT)
+            raii_panic("Result slots exhausted!");
+
+        result = raii_result_page(index) + (index % RAII_RESULT_PAGE);
+        result->id = (rid_t)index;
+    }
 
+    memset(&result->value, 0, sizeof(raii_values_t));
     result->is_ready = false;
-    result->id = id;
     result->result = nullptr;
+    result->next = 0;
     result->type = RAII_VALUE;
-    results[id] = result;
-    atomic_store_explicit(&gq_result.results, results, memory_order_release);
     return result;
 }
 
+void raii_result_free(rid_t id) {
+    result_t result = raii_result_get(id);
+    size_t index = RAII_RESULT_INDEX(id);
+    if (!is_type(result, RAII_VALUE))
+        return;
+
+    result->type = RAII_ERR;
+    result->is_ready = false;
+    result->result = nullptr;
+    result->id = (rid_t)((((id >> RAII_RESULT_BITS) + 1) << RAII_RESULT_BITS) | index);
+    result->next = 0;
+    atomic_lock(&gq_result.result_lock);
+    if (gq_result.result_tail == 0)
+        gq_result.result_head = (u32)index + 1;
+    else
+        raii_result_slot(gq_result.result_tail - 1)->next = (u32)index + 1;
+
+    gq_result.result_tail = (u32)index + 1;
+    atomic_fetch_add(&gq_result.result_free, 1);
+    atomic_unlock(&gq_result.result_lock);
+}
+
+void raii_result_destroy(void) {
+    size_t i;
+    result_t page;
+    for (i = 0; i < RAII_RESULT_PAGES; i++) {
+        if (!is_empty(page = (result_t)atomic_load(&gq_result.results[i]))) {
+            atomic_store(&gq_result.results[i], nullptr);
+            free(page);
+        }
+    }
+
+    gq_result.result_head = gq_result.result_tail = 0;
+    atomic_store(&gq_result.result_free, 0);
+    atomic_store(&gq_result.result_id_generate, 0);
+}
+
 RAII_INLINE int exit_scope(void) {
     raii_deferred_free(get_scope());
     return 0;
@@ -297,8 +390,10 @@ memory_t *raii_init(void) {
         scope->threaded = NULL;
         scope->local = NULL;
         scope->queued = NULL;
+        scope->region = NULL;
         scope->is_protected = false;
         scope->is_recovered = false;
+        atomic_flag_clear(&scope->promise_lock);
 
         ex_context_t *ctx = ex_init();
         ctx->data = (void_t)scope;
@@ -381,7 +476,9 @@ unique_t *unique_init(void) {
 
     raii->arena = NULL;
     raii->protector = NULL;
+    raii->region = NULL;
     raii->is_protected = false;
+    atomic_flag_clear(&raii->promise_lock);
     return raii;
 }
 
@@ -398,7 +495,10 @@ void_t malloc_full(memory_t *scope, size_t size, func_t func) {
 }
 
 RAII_INLINE void_t malloc_local(size_t size) {
-    return malloc_full(get_scope(), size, free);
+    void_t arena = malloc_full(get_scope(), size, free);
+    preempt_check();
+
+    return arena;
 }
 
 void_t calloc_full(memory_t *scope, int count, size_t size, func_t func) {
@@ -414,7 +514,285 @@ void_t calloc_full(memory_t *scope, int count, size_t size, func_t func) {
 }
 
 RAII_INLINE void_t calloc_local(int count, size_t size) {
-    return calloc_full(get_scope(), count, size, free);
+    void_t arena = calloc_full(get_scope(), count, size, free);
+    preempt_check();
+
+    return arena;
+}
+
+/* Header of region chunk, rounded so chunk data is aligned for any type. */
+#define RAII_ARENA_HEADER ((sizeof(raii_arena_t) + 15) & ~(size_t)15)
+
+static raii_arena_t *raii_arena_block(size_t size) {
+    raii_arena_t *block = try_malloc(RAII_ARENA_HEADER + size);
+    block->next = NULL;
+    block->used = 0;
+    block->size = size;
+
+    return block;
+}
+
+void_t malloc_arena(memory_t *scope, size_t size) {
+    raii_arena_t *block = scope->region;
+    void_t ptr;
+
+    size = (size + 15) & ~(size_t)15;
+    if (UNLIKELY(size == 0))
+        size = 16;
+
+    if (is_empty(block) || block->size - block->used < size) {
+        if (size > RAII_ARENA_BLOCK / 4) {
+            /* Own chunk, linked behind current one, which keeps it's free space. */
+            block = raii_arena_block(size);
+            block->used = size;
+            if (is_empty(scope->region)) {
+                scope->region = block;
+            } else {
+                block->next = scope->region->next;
+                scope->region->next = block;
+            }
+
+            return (unsigned char *)block + RAII_ARENA_HEADER;
+        }
+
+        block = raii_arena_block(RAII_ARENA_BLOCK);
+        block->next = scope->region;
+        scope->region = block;
+    }
+
+    ptr = (unsigned char *)block + RAII_ARENA_HEADER + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+RAII_INLINE void_t calloc_arena(memory_t *scope, int count, size_t size) {
+    return memset(malloc_arena(scope, (size_t)count * size), 0, (size_t)count * size);
+}
+
+/* Release all region chunks of `scope` at once. */
+static void raii_arena_free(memory_t *scope) {
+    raii_arena_t *next, *block = scope->region;
+    for (scope->region = NULL; !is_empty(block); block = next) {
+        next = block->next;
+        free(block);
+    }
+}
+
+/* Object links, kept past first word, so an freed object's type field stays as set. */
+#define RAII_POOL_NEXT(obj) (((void_t *)(obj))[1])
+#define RAII_POOL_BATCH_NEXT(obj) (((void_t *)(obj))[2])
+#define RAII_POOL_BATCH_COUNT(obj) (((size_t *)(obj))[3])
+#define RAII_POOL_LINKS (sizeof(void_t) * 4)
+/* Header of pool chunk, rounded so objects are aligned for any type. */
+#define RAII_POOL_HEADER ((sizeof(void_t) + 15) & ~(size_t)15)
+
+typedef struct {
+    void_t head;
+    size_t count;
+    /* objects taken, less those returned, not yet added to pool's `in_use` */
+    size_t used;
+} raii_pool_cache_t;
+
+typedef struct {
+    raii_pool_cache_t cache[RAII_POOL_MAX];
+} raii_pool_caches_t;
+thrd_static(raii_pool_caches_t, pool_caches, NULL)
+
+static raii_pool_t *raii_pools[RAII_POOL_MAX] = {0};
+static atomic_size_t raii_pool_slots = 0;
+
+/* Cache index of `pool`, assigned on first use, `RAII_POOL_MAX` if none left. */
+static size_t raii_pool_slot(raii_pool_t *pool) {
+    size_t slot = atomic_load_explicit(&pool->slot, memory_order_acquire);
+    if (UNLIKELY(slot == 0)) {
+        atomic_lock(&pool->lock);
+        if ((slot = atomic_load(&pool->slot)) == 0) {
+            pool->size = (pool->size + 15) & ~(size_t)15;
+            if (pool->size < RAII_POOL_LINKS)
+                pool->size = RAII_POOL_LINKS;
+
+            slot = atomic_fetch_add(&raii_pool_slots, 1);
+            if (slot < RAII_POOL_MAX)
+                raii_pools[slot] = pool;
+            else
+                slot = RAII_POOL_MAX;
+
+            atomic_store_explicit(&pool->slot, ++slot, memory_order_release);
+        }
+        atomic_unlock(&pool->lock);
+    }
+
+    return slot - 1;
+}
+
+static RAII_INLINE void raii_pool_publish(raii_pool_t *pool, raii_pool_cache_t *cache) {
+    if (cache->used) {
+        atomic_fetch_add(&pool->in_use, cache->used);
+        cache->used = 0;
+    }
+}
+
+/* Fill empty `cache` with an batch handed back to `pool`, otherwise carve an new chunk. */
+static void raii_pool_refill(raii_pool_t *pool, raii_pool_cache_t *cache) {
+    unsigned char *chunk, *obj;
+    void_t batch;
+    size_t i;
+
+    raii_pool_publish(pool, cache);
+    atomic_lock(&pool->lock);
+    if (!is_empty(batch = pool->shared)) {
+        pool->shared = RAII_POOL_BATCH_NEXT(batch);
+        pool->spare -= RAII_POOL_BATCH_COUNT(batch);
+        atomic_unlock(&pool->lock);
+        cache->count = RAII_POOL_BATCH_COUNT(batch);
+        cache->head = batch;
+        return;
+    }
+    atomic_unlock(&pool->lock);
+
+    chunk = try_malloc(RAII_POOL_HEADER + pool->size * RAII_POOL_BATCH);
+    obj = chunk + RAII_POOL_HEADER;
+    for (i = 1; i < RAII_POOL_BATCH; i++, obj += pool->size)
+        RAII_POOL_NEXT(obj) = obj + pool->size;
+
+    RAII_POOL_NEXT(obj) = NULL;
+    cache->head = chunk + RAII_POOL_HEADER;
+    cache->count = RAII_POOL_BATCH;
+
+    atomic_lock(&pool->lock);
+    *(void_t *)chunk = pool->chunks;
+    pool->chunks = chunk;
+    pool->capacity += RAII_POOL_BATCH;
+    pool->chunk_count++;
+    atomic_unlock(&pool->lock);
+}
+
+/* Hand first `count` objects of `cache` back to `pool`, as one batch. */
+static void raii_pool_spill(raii_pool_t *pool, raii_pool_cache_t *cache, size_t count) {
+    void_t batch = cache->head, last = batch;
+    size_t i;
+
+    raii_pool_publish(pool, cache);
+    for (i = 1; i < count; i++)
+        last = RAII_POOL_NEXT(last);
+
+    cache->head = RAII_POOL_NEXT(last);
+    cache->count -= count;
+    RAII_POOL_NEXT(last) = NULL;
+    RAII_POOL_BATCH_COUNT(batch) = count;
+
+    atomic_lock(&pool->lock);
+    RAII_POOL_BATCH_NEXT(batch) = pool->shared;
+    pool->shared = batch;
+    pool->spare += count;
+    atomic_unlock(&pool->lock);
+}
+
+void_t raii_pool_alloc(raii_pool_t *pool) {
+    size_t slot = raii_pool_slot(pool);
+    raii_pool_cache_t *cache;
+    void_t obj;
+
+    if (UNLIKELY(slot == RAII_POOL_MAX)) {
+        atomic_fetch_add(&pool->in_use, 1);
+        return try_calloc(1, pool->size);
+    }
+
+    cache = &pool_caches()->cache[slot];
+    if (is_empty(cache->head))
+        raii_pool_refill(pool, cache);
+
+    obj = cache->head;
+    cache->head = RAII_POOL_NEXT(obj);
+    cache->count--;
+    cache->used++;
+
+    return memset(obj, 0, pool->size);
+}
+
+void raii_pool_free(raii_pool_t *pool, void_t ptr) {
+    size_t slot;
+    raii_pool_cache_t *cache;
+
+    if (is_empty(ptr))
+        return;
+
+    if (UNLIKELY((slot = raii_pool_slot(pool)) == RAII_POOL_MAX)) {
+        atomic_fetch_sub(&pool->in_use, 1);
+        free(ptr);
+        return;
+    }
+
+    cache = &pool_caches()->cache[slot];
+    RAII_POOL_NEXT(ptr) = cache->head;
+    cache->head = ptr;
+    cache->used--;
+    if (++cache->count == RAII_POOL_BATCH * 2)
+        raii_pool_spill(pool, cache, RAII_POOL_BATCH);
+}
+
+void raii_pool_flush(void) {
+    raii_pool_caches_t *caches;
+    size_t i, count = atomic_load(&raii_pool_slots);
+
+    if (count > RAII_POOL_MAX)
+        count = RAII_POOL_MAX;
+
+    for (caches = pool_caches(), i = 0; i < count; i++) {
+        if (is_empty(raii_pools[i]))
+            continue;
+
+        raii_pool_publish(raii_pools[i], &caches->cache[i]);
+        if (caches->cache[i].count)
+            raii_pool_spill(raii_pools[i], &caches->cache[i], caches->cache[i].count);
+    }
+}
+
+raii_pool_stats_t raii_pool_stats(raii_pool_t *pool) {
+    raii_pool_stats_t stats;
+    size_t slot = raii_pool_slot(pool);
+
+    atomic_lock(&pool->lock);
+    stats.capacity = pool->capacity;
+    stats.chunks = pool->chunk_count;
+    stats.shared = pool->spare;
+    atomic_unlock(&pool->lock);
+
+    stats.name = pool->name;
+    stats.size = pool->size;
+    stats.in_use = atomic_load(&pool->in_use);
+    stats.cached = 0;
+    if (slot < RAII_POOL_MAX) {
+        stats.in_use += pool_caches()->cache[slot].used;
+        stats.cached = pool_caches()->cache[slot].count;
+    }
+
+    return stats;
+}
+
+void raii_pool_print(FILE *out) {
+    raii_pool_stats_t stats;
+    size_t i, count = atomic_load(&raii_pool_slots);
+    bool first = true;
+
+    if (count > RAII_POOL_MAX)
+        count = RAII_POOL_MAX;
+
+    fputs("{\"pools\":[", out);
+    for (i = 0; i < count; i++) {
+        if (is_empty(raii_pools[i]))
+            continue;
+
+        stats = raii_pool_stats(raii_pools[i]);
+        fprintf(out, "%s{\"name\":\"%s\",\"size\":%zu,\"capacity\":%zu,\"chunks\":%zu,"
+                "\"in_use\":%zu,\"shared\":%zu,\"cached\":%zu}", first ? "" : ",",
+                stats.name, stats.size, stats.capacity, stats.chunks,
+                stats.in_use, stats.shared, stats.cached);
+        first = false;
+    }
+    fputs("]}\n", out);
+    fflush(out);
 }
 
 void raii_delete(memory_t *ptr) {
@@ -459,12 +837,37 @@ static RAII_INLINE defer_t *raii_deferred_array_new(memory_t *scope) {
     return (defer_t *)raii_array_new(scope);
 }
 
-static RAII_INLINE defer_func_t *raii_deferred_array_append(defer_t *array) {
-    return (defer_func_t *)raii_array_append((raii_array_t *)array, sizeof(defer_func_t));
+/* Next `defer` record of `scope`, from it's inline buffer until full, then heap. */
+static defer_func_t *raii_deferred_array_append(memory_t *scope) {
+    raii_array_t *array = (raii_array_t *)&scope->defer;
+    defer_func_t *spill;
+    size_t capacity;
+
+    if (is_empty(array->base) || array->base == (void_t)scope->defer_inline) {
+        if (array->elements < RAII_DEFER_INLINE) {
+            array->base = scope->defer_inline;
+            return &scope->defer_inline[array->elements++];
+        }
+
+        /* Capacity `raii_array_append` expects, next `INCREMENT` multiple. */
+        capacity = (array->elements / INCREMENT + 1) * INCREMENT;
+        if (UNLIKELY(!(spill = realloc_array(NULL, capacity, sizeof(defer_func_t)))))
+            return NULL;
+
+        memcpy(spill, scope->defer_inline, array->elements * sizeof(defer_func_t));
+        array->base = spill;
+    }
+
+    return (defer_func_t *)raii_array_append(array, sizeof(defer_func_t));
 }
 
-static RAII_INLINE int raii_deferred_array_reset(defer_t *array) {
-    return raii_array_reset((raii_array_t *)array);
+static RAII_INLINE int raii_deferred_array_reset(memory_t *scope) {
+    raii_array_t *array = (raii_array_t *)&scope->defer;
+    /* Inline buffer isn't heap memory. */
+    if (array->base == (void_t)scope->defer_inline)
+        array->base = NULL;
+
+    return raii_array_reset(array);
 }
 
 static RAII_INLINE void raii_deferred_array_free(defer_t *array) {
@@ -531,8 +934,12 @@ void raii_deferred_free(memory_t *scope) {
 
     if (is_type(&scope->defer, RAII_DEF_ARR)) {
         raii_deferred_run(scope, 0);
-        raii_deferred_array_reset(&scope->defer);
+        raii_deferred_array_reset(scope);
     }
+
+    /* After `defer`s, any can still be using region memory. */
+    if (!is_empty(scope->region))
+        raii_arena_free(scope);
 }
 
 RAII_INLINE void raii_deferred_clean(void) {
@@ -545,7 +952,7 @@ static size_t raii_deferred_any(memory_t *scope, func_t func, void_t data, void_
 
     RAII_ASSERT(func);
 
-    deferred = raii_deferred_array_append(&scope->defer);
+    deferred = raii_deferred_array_append(scope);
     if (UNLIKELY(!deferred)) {
         RAII_LOG("Could not add new deferred function.");
         return RAII_ERR;
@@ -563,11 +970,17 @@ RAII_INLINE size_t raii_deferred(memory_t *scope, func_t func, void_t data) {
 }
 
 RAII_INLINE size_t raii_defer(func_t func, void_t data) {
-    return raii_deferred(raii_local(), func, data);
+    size_t index = raii_deferred(raii_local(), func, data);
+    preempt_check();
+
+    return index;
 }
 
 RAII_INLINE size_t deferring(func_t func, void_t data) {
-    return raii_deferred(get_scope(), func, data);
+    size_t index = raii_deferred(get_scope(), func, data);
+    preempt_check();
+
+    return index;
 }
 
 RAII_INLINE void raii_recover(func_t func, void_t data) {
@@ -281,11 +281,8 @@ RAII_INLINE string simd_itoa(int64_t x, string buf) {
     *buf = '-'; // Always write
     buf += neg; // But advance only if negative
 
-#if defined(__APPLE__) || defined(__MACH__)
-    x = llabs(x);
-#else
-    x = abs(x);
-#endif
+    // Not abs(), it truncates to int
+    x = neg ? -x : x;
 
     char tmp[20];
     string p = tmp + 20;
@@ -303,7 +300,7 @@ RAII_INLINE string simd_itoa(int64_t x, string buf) {
 
     uint32_t len = tmp + 20 - p;
 
-    memcpy(buf, p, 20);
+    memcpy(buf, p, len);
     buf[len] = '\0';
 
     return buf;
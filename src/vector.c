@@ -7,15 +7,6 @@ Modified version of https://github.com/eteran/c-vector
 
 #include "raii.h"
 
-typedef struct vector_metadata_s {
-    raii_type type;
-    int defer_set;
-    size_t size;
-    size_t capacity;
-    func_t destructor;
-    memory_t *context;
-} vector_metadata_t;
-
 #define vector_address(vec) (&((vector_metadata_t *)(vec))[-1])
 #define vector_base(ptr) ((void_t)&((vector_metadata_t *)(ptr))[1])
 #define vector_set_context(vec, ptr) vector_address(vec)->context = (ptr)
@@ -30,11 +21,21 @@ typedef struct vector_metadata_s {
 #define vector_length(vec) ((vec) ? vector_address(vec)->size : (size_t)0)
 #define vector_type(vec) ((vec) ? vector_address(vec)->type : RAII_ERR)
 #define vector_deferred(vec) vector_address(vec)->defer_set
+/* Built by `array_inline` in storage it doesn't own. */
+#define vector_inlined(vec) (vector_address(vec)->defer_set == RAII_ERR)
 #define vector_cap(vec) ((vec) ? vector_address(vec)->capacity : (size_t)0)
 #define vector_grow(vec, count, scope)                     \
     do {                                            \
         const size_t cv_sz__ = (count) * sizeof(*(vec)) + sizeof(vector_metadata_t);    \
-        if (vec) {                                  \
+        if (vec && vector_inlined(vec)) {           \
+            void *cv_p3__ = try_malloc(cv_sz__);    \
+            memcpy(cv_p3__, vector_address(vec), sizeof(vector_metadata_t)   \
+                   + vector_length(vec) * sizeof(*(vec)));  \
+            (vec) = vector_base(cv_p3__);           \
+            vector_defer_unset(vec);                \
+            if (vector_context(vec))                \
+                array_deferred_set((arrays_t)(vec), vector_context(vec));    \
+        } else if (vec) {                           \
             void *cv_p1__ = vector_address(vec);    \
             void *cv_p2__ = try_realloc(cv_p1__, cv_sz__);  \
             (vec) = vector_base(cv_p2__);           \
@@ -56,7 +57,7 @@ static RAII_INLINE size_t vec_num(void) {
 }
 
 static RAII_INLINE void vector_delete(vectors_t vec) {
-    if (vec) {
+    if (vec && !vector_inlined(vec)) {
         void_t p1__ = vector_address(vec);
         func_t destructor__ = vector_destructor(vec);
         if (destructor__) {
@@ -214,6 +215,10 @@ arrays_t array_ex(memory_t *scope, size_t num_of, va_list ap_copy) {
     if (num_of > 0) {
         va_copy(ap, ap_copy);
         params = array_of(scope, 0);
+        /* `$append` can't return an moved array, size it first. */
+        if (vector_cap(params) <= num_of)
+            vector_grow(params, num_of + 1, scope);
+
         for (i = 0; i < num_of; i++)
             $append(params, va_arg(ap, void_t));
         va_end(ap);
@@ -222,6 +227,31 @@ arrays_t array_ex(memory_t *scope, size_t num_of, va_list ap_copy) {
     return params;
 }
 
+arrays_t array_inline(void_t buffer, size_t size, memory_t *scope, size_t num_of, va_list ap_copy) {
+    va_list ap;
+    size_t i;
+    arrays_t params;
+
+    if (num_of == 0 || size < sizeof(vector_metadata_t) + num_of * sizeof(template))
+        return nullptr;
+
+    params = vector_base(buffer);
+    vector_set_size(params, 0);
+    vector_set_destructor(params, NULL);
+    vector_set_context(params, scope);
+    vector_set_type(params, RAII_ARRAY);
+    vector_set_capacity(params, (size - sizeof(vector_metadata_t)) / sizeof(template));
+    vector_address(params)->defer_set = RAII_ERR;
+
+    va_copy(ap, ap_copy);
+    for (i = 0; i < num_of; i++)
+        params[i].object = va_arg(ap, void_t);
+    va_end(ap);
+
+    vector_set_size(params, num_of);
+    return params;
+}
+
 RAII_INLINE arrays_t array_copy(arrays_t des, arrays_t src) {
     memory_t *scope;
     size_t cv_sz___;
@@ -293,7 +323,8 @@ RAII_INLINE void array_remove(arrays_t arr, size_t i) {
 }
 
 RAII_INLINE void array_delete(arrays_t arr) {
-    if (arr) {
+    /* `array_inline` storage isn't ours to free. */
+    if (arr && !vector_inlined(arr)) {
         void_t p1__ = vector_address(arr);
         func_t destructor__ = vector_destructor(arr);
         if (destructor__) {
@@ -378,6 +409,17 @@ void array_append_item(arrays_t arr, ...) {
     vector_set_size(arr, index + 1);
 }
 
+arrays_t array_reserve(arrays_t arr, size_t count) {
+    memory_t *scope;
+    size_t cap = vector_cap(arr);
+    if (arr && cap < count) {
+        scope = vector_context(arr);
+        vector_grow(arr, (cap << 1) > count ? cap << 1 : count, scope);
+    }
+
+    return arr;
+}
+
 RAII_INLINE arrays_t array_reset(arrays_t arr) {
     vector_clear((vectors_t)arr);
     return arr;
@@ -0,0 +1,73 @@
+#include "raii.h"
+#include "test_assert.h"
+
+static atomic_size_t finished;
+
+void_t worker(params_t args) {
+    int i, rounds = args[0].integer;
+
+    for (i = 0; i < rounds; i++)
+        yield();
+
+    atomic_fetch_add(&finished, 1);
+    return 0;
+}
+
+TEST(coro_workers) {
+    u32 i;
+
+    for (i = 0; i < 16; i++)
+        go(worker, 1, casting(10));
+
+    while (atomic_load(&finished) < 16)
+        sleepfor(10);
+
+    ASSERT_UEQ(3, coro_stats_snapshot().workers);
+    ASSERT_UEQ(0, coro_stats_worker(3).workers);
+
+    return 0;
+}
+
+TEST(coro_affinity) {
+    char line[4096] = {0};
+    FILE *out = tmpfile();
+
+    /* main thread is never pinned */
+    ASSERT_EQ(RAII_ERR, coro_thrd_cpu(0));
+    ASSERT_EQ(RAII_ERR, coro_thrd_cpu(3));
+#if defined(__linux__)
+    ASSERT_TRUE((coro_thrd_cpu(1) >= 0));
+    ASSERT_TRUE((coro_thrd_cpu(2) >= 0));
+    /* compact, worker `n` on `n`th allowed cpu */
+    if (thrd_cpu_count() > 2)
+        ASSERT_TRUE((coro_thrd_cpu(1) < coro_thrd_cpu(2)));
+#endif
+
+    ASSERT_NOTNULL(out);
+    coro_stats_print(out);
+    rewind(out);
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    ASSERT_NOTNULL(strstr(line, "\"cpu\":-1}"));
+    fclose(out);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_workers);
+    EXEC_TEST(coro_affinity);
+
+    return result;
+}
+
+static int test_main(u32 argc, void_t argv) {
+    TEST_FUNC(list());
+}
+
+int main(int argc, char **argv) {
+    coro_workers(3);
+    coro_affinity(CORO_AFFINITY_COMPACT, nullptr);
+    return coro_start(test_main, (u32)argc, argv, 0);
+}
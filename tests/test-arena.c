@@ -0,0 +1,74 @@
+#include "raii.h"
+#include "test_assert.h"
+
+static int deferred_sum = 0;
+
+void sum_region(void_t data) {
+    int *values = (int *)data;
+    deferred_sum = values[0] + values[99];
+}
+
+TEST(malloc_arena) {
+    unique_t *scope = unique_init();
+    char *first, *p = nullptr;
+    int i, *values;
+
+    first = malloc_arena(scope, 24);
+    ASSERT_NOTNULL(first);
+    for (i = 0; i < 1000; i++) {
+        p = malloc_arena(scope, 24);
+        ASSERT_TRUE((((uintptr_t)p & 15) == 0));
+        memset(p, i & 0xff, 24);
+    }
+
+    /* no `defer` record per allocation */
+    ASSERT_UEQ(0, raii_deferred_count(scope));
+    ASSERT_EQ((999 & 0xff), (unsigned char)p[23]);
+
+    /* larger than any chunk */
+    p = malloc_arena(scope, RAII_ARENA_BLOCK * 2);
+    memset(p, 1, RAII_ARENA_BLOCK * 2);
+    ASSERT_UEQ(0, raii_deferred_count(scope));
+
+    values = calloc_arena(scope, 100, sizeof(int));
+    ASSERT_EQ(0, values[0]);
+    ASSERT_EQ(0, values[99]);
+    values[0] = 40;
+    values[99] = 2;
+
+    /* region outlives `defer`s of same scope */
+    raii_deferred(scope, sum_region, values);
+    raii_delete(scope);
+    ASSERT_EQ(42, deferred_sum);
+
+    return 0;
+}
+
+TEST(arena_reuse) {
+    unique_t *scope = unique_init();
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        ASSERT_NOTNULL(malloc_arena(scope, 64));
+        ASSERT_NOTNULL(scope->region);
+        raii_deferred_free(scope);
+        ASSERT_NULL(scope->region);
+    }
+
+    raii_delete(scope);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(malloc_arena);
+    EXEC_TEST(arena_reuse);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -27,10 +27,179 @@ TEST(chan_send) {
     return 0;
 }
 
+#define MPMC_COUNT 1000
+
+void *mpmc_producer(params_t args) {
+    channel_t c = args[0].object;
+    int i;
+
+    for (i = 1; i <= MPMC_COUNT; i++)
+        chan_send(c, casting(i));
+
+    return casting(coro_thrd_id() + 1);
+}
+
+void *mpmc_consumer(params_t args) {
+    channel_t c = args[0].object;
+    size_t sum = 0;
+    int i;
+
+    for (i = 0; i < MPMC_COUNT; i++)
+        sum += chan_recv(c).integer;
+
+    return casting(sum);
+}
+
+TEST(chan_mpmc) {
+    channel_t buffered = channel_buf(4), unbuffered = channel();
+    waitgroup_t wg;
+    waitresult_t wgr;
+    rid_t consumers[2];
+    size_t expect = (size_t)MPMC_COUNT * (MPMC_COUNT + 1) / 2;
+
+    wg = waitgroup();
+    go(mpmc_producer, 1, buffered);
+    go(mpmc_producer, 1, unbuffered);
+    consumers[0] = go(mpmc_consumer, 1, buffered);
+    consumers[1] = go(mpmc_consumer, 1, unbuffered);
+    wgr = waitfor(wg);
+
+    ASSERT_UEQ(expect, result_for(consumers[0]).max_size);
+    ASSERT_UEQ(expect, result_for(consumers[1]).max_size);
+    channel_free(buffered);
+    channel_free(unbuffered);
+
+    return 0;
+}
+
+void *select_sender(params_t args) {
+    channel_t c = args[0].object;
+
+    sleepfor(10);
+    chan_send(c, casting(42));
+    return 0;
+}
+
+TEST(chan_select) {
+    channel_t quiet = channel(), busy = channel(), full = channel_buf(1);
+    chan_op_t ops[2];
+    uint64_t start;
+
+    ops[0].ch = quiet;
+    ops[0].op = CHAN_RECV;
+    ops[1].ch = full;
+    ops[1].op = CHAN_SEND;
+    ops[1].value.integer = 7;
+    ASSERT_EQ(1, chan_select(ops, 2, 0));
+    /* now full, nothing can proceed */
+    ASSERT_EQ(-1, chan_select(ops, 2, 0));
+    start = get_timer();
+    ASSERT_EQ(-1, chan_select(ops, 2, 20));
+    ASSERT_TRUE((get_timer() - start >= 15000000));
+
+    ops[1].op = CHAN_RECV;
+    ASSERT_EQ(1, chan_select(ops, 2, -1));
+    ASSERT_EQ(7, ops[1].value.integer);
+
+    /* parks on both, until sender hands over */
+    go(select_sender, 1, busy);
+    ops[1].ch = busy;
+    ASSERT_EQ(1, chan_select(ops, 2, -1));
+    ASSERT_EQ(42, ops[1].value.integer);
+
+    channel_free(quiet);
+    channel_free(busy);
+    channel_free(full);
+
+    return 0;
+}
+
+typedef struct {
+    int id;
+    double x;
+} batch_item;
+
+#define BATCH_COUNT 100
+
+void *batch_producer(params_t args) {
+    channel_t c = args[0].object;
+    batch_item items[10];
+    int i, j;
+
+    for (i = 0; i < BATCH_COUNT; i += 10) {
+        for (j = 0; j < 10; j++) {
+            items[j].id = i + j;
+            items[j].x = (i + j) * 0.5;
+        }
+
+        chan_send_n(c, items, 10);
+    }
+
+    return 0;
+}
+
+TEST(chan_batch) {
+    channel_t c = channel_of(sizeof(batch_item), 8);
+    batch_item items[16];
+    size_t n, i;
+    int next = 0;
+    bool ordered = true;
+
+    go(batch_producer, 1, c);
+    while (next < BATCH_COUNT) {
+        n = chan_recv_n(c, items, 16);
+        ASSERT_TRUE((n >= 1 && n <= 8));
+        for (i = 0; i < n; i++, next++)
+            ordered &= items[i].id == next && items[i].x == next * 0.5;
+    }
+
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(BATCH_COUNT, next);
+    channel_free(c);
+
+    return 0;
+}
+
+/* Same size as boxed `raii_values_t`, still copied inline. */
+typedef struct {
+    unsigned char bytes[sizeof(raii_values_t)];
+} wide_item;
+
+TEST(chan_wide) {
+    channel_t c = channel_of(sizeof(wide_item), 2);
+    wide_item sent, got;
+    chan_op_t ops[1];
+    size_t i;
+
+    for (i = 0; i < sizeof(sent.bytes); i++)
+        sent.bytes[i] = (unsigned char)(i + 1);
+
+    chan_send(c, &sent);
+    memset(&got, 0, sizeof(got));
+    ASSERT_UEQ(1, chan_recv_n(c, &got, 1));
+    ASSERT_EQ(0, memcmp(&sent, &got, sizeof(wide_item)));
+
+    chan_send(c, &sent);
+    memset(&got, 0, sizeof(got));
+    ops[0].ch = c;
+    ops[0].op = CHAN_RECV;
+    ops[0].value.object = &got;
+    ASSERT_EQ(0, chan_select(ops, 1, 0));
+    ASSERT_PTR(&got, ops[0].value.object);
+    ASSERT_EQ(0, memcmp(&sent, &got, sizeof(wide_item)));
+    channel_free(c);
+
+    return 0;
+}
+
 TEST(list) {
     int result = 0;
 
     EXEC_TEST(chan_send);
+    EXEC_TEST(chan_select);
+    EXEC_TEST(chan_mpmc);
+    EXEC_TEST(chan_batch);
+    EXEC_TEST(chan_wide);
     return result;
 }
 
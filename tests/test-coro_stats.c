@@ -0,0 +1,81 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+static atomic_size_t finished;
+
+void_t worker(params_t args) {
+    int i, rounds = args[0].integer;
+
+    for (i = 0; i < rounds; i++)
+        yield();
+
+    atomic_fetch_add(&finished, 1);
+    return 0;
+}
+
+TEST(coro_stats_snapshot) {
+    coro_stats_t stats, before = coro_stats_snapshot();
+    size_t switches = 0;
+    u32 i;
+
+    for (i = 0; i < 32; i++)
+        go(worker, 1, casting(10));
+
+    while (atomic_load(&finished) < 32)
+        sleepfor(10);
+
+    sleepfor(10);
+    stats = coro_stats_snapshot();
+    ASSERT_TRUE((stats.workers >= 1));
+    ASSERT_TRUE((stats.spawned - before.spawned >= 32));
+    ASSERT_TRUE((stats.completed - before.completed >= 32));
+    ASSERT_TRUE((stats.switches - before.switches >= 32 * 10));
+    ASSERT_TRUE((stats.run_ns > before.run_ns));
+    ASSERT_TRUE((stats.run_ns + stats.idle_ns > 0));
+
+    for (i = 0; i < stats.workers; i++)
+        switches += coro_stats_worker(i).switches;
+
+    ASSERT_TRUE((switches >= stats.switches));
+    ASSERT_UEQ(0, coro_stats_worker((u32)-1).workers);
+
+    return 0;
+}
+
+TEST(coro_stats_print) {
+    char line[4096] = {0};
+    FILE *out = tmpfile();
+
+    ASSERT_NOTNULL(out);
+    coro_stats_print(out);
+    rewind(out);
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    ASSERT_EQ(0, strncmp(line, "{\"time_ns\":", 11));
+    ASSERT_NOTNULL(strstr(line, "\"total\":{\"workers\":"));
+    ASSERT_STR("]}\n", line + strlen(line) - 3);
+
+    coro_stats_every(out, 5);
+    sleepfor(30);
+    coro_stats_every(out, 0);
+    rewind(out);
+    /* first line, and at least one more from the dump thread */
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    fclose(out);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_stats_snapshot);
+    EXEC_TEST(coro_stats_print);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
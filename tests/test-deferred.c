@@ -0,0 +1,56 @@
+#include "raii.h"
+#include "test_assert.h"
+
+static int order[64], ran = 0;
+
+void record(void_t data) {
+    order[ran++] = (int)(intptr_t)data;
+}
+
+TEST(deferred_inline) {
+    unique_t *scope = unique_init();
+    int i;
+
+    for (i = 0; i < RAII_DEFER_INLINE; i++)
+        raii_deferred(scope, record, (void_t)(intptr_t)i);
+
+    ASSERT_UEQ(RAII_DEFER_INLINE, raii_deferred_count(scope));
+    raii_deferred_free(scope);
+    ASSERT_EQ(RAII_DEFER_INLINE, ran);
+    for (i = 0; i < RAII_DEFER_INLINE; i++)
+        ASSERT_EQ(RAII_DEFER_INLINE - 1 - i, order[i]);
+
+    raii_delete(scope);
+    return 0;
+}
+
+TEST(deferred_spill) {
+    unique_t *scope = unique_init();
+    int i, count = RAII_DEFER_INLINE * 2 + 3;
+
+    ran = 0;
+    for (i = 0; i < count; i++)
+        raii_deferred(scope, record, (void_t)(intptr_t)i);
+
+    ASSERT_UEQ(count, raii_deferred_count(scope));
+    raii_delete(scope);
+    /* `LIFO` across inline records, and those spilled to heap */
+    ASSERT_EQ(count, ran);
+    for (i = 0; i < count; i++)
+        ASSERT_EQ(count - 1 - i, order[i]);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(deferred_inline);
+    EXEC_TEST(deferred_spill);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -0,0 +1,101 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+#define FS_BYTES (256 * 1024)
+#define FS_READERS 16
+
+static char fs_path[] = "/tmp/raii_fs_XXXXXX";
+static char fs_copy[] = "/tmp/raii_fs_XXXXXX";
+
+static ssize_t fs_fill(string_t path) {
+    static char buf[FS_BYTES];
+    ssize_t n;
+    int fd = coro_fs_open(path, O_WRONLY | O_TRUNC, 0600);
+
+    if (fd < 0)
+        return -1;
+
+    memset(buf, 'f', FS_BYTES);
+    n = coro_fs_write(fd, buf, FS_BYTES, 0);
+    if (coro_fs_fsync(fd) < 0)
+        n = -1;
+
+    coro_fs_close(fd);
+    return n;
+}
+
+void_t fs_writer(params_t args) {
+    return casting(fs_fill(args[0].char_ptr));
+}
+
+void_t fs_reader(params_t args) {
+    struct stat st;
+    char buf[4096];
+    size_t total = 0;
+    ssize_t n;
+    int i, fd;
+
+    if (coro_fs_stat(fs_path, &st) < 0 || st.st_size != FS_BYTES)
+        return casting(-1);
+
+    if ((fd = coro_fs_open(fs_path, O_RDONLY, 0)) < 0)
+        return casting(-1);
+
+    while ((n = coro_fs_read(fd, buf, sizeof(buf), -1)) > 0) {
+        for (i = 0; i < n; i++)
+            if (buf[i] != 'f')
+                return casting(-1);
+        total += n;
+    }
+
+    coro_fs_close(fd);
+    return casting(total);
+}
+
+TEST(coro_fs) {
+    struct stat st;
+    waitgroup_t wg;
+    waitresult_t wgr;
+    rid_t writer, readers[FS_READERS];
+    int i, fd = mkstemp(fs_path);
+
+    ASSERT_TRUE((fd >= 0));
+    close(fd);
+    ASSERT_TRUE(((fd = mkstemp(fs_copy)) >= 0));
+    close(fd);
+
+    /* from main coroutine, before others are spawned */
+    ASSERT_EQ(FS_BYTES, (int)fs_fill(fs_path));
+    ASSERT_EQ(-1, coro_fs_open("/nonexistent/raii_fs", O_RDONLY, 0));
+    ASSERT_EQ(ENOENT, errno);
+
+    wg = waitgroup();
+    writer = go(fs_writer, 1, fs_copy);
+    for (i = 0; i < FS_READERS; i++)
+        readers[i] = go(fs_reader, 0);
+    wgr = waitfor(wg);
+
+    ASSERT_UEQ(FS_BYTES, result_for(writer).max_size);
+    for (i = 0; i < FS_READERS; i++)
+        ASSERT_UEQ(FS_BYTES, result_for(readers[i]).max_size);
+
+    ASSERT_EQ(0, coro_fs_stat(fs_copy, &st));
+    ASSERT_EQ(FS_BYTES, (int)st.st_size);
+    unlink(fs_path);
+    unlink(fs_copy);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_fs);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
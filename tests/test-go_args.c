@@ -0,0 +1,39 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+void_t sum_args(params_t args) {
+    size_t i, sum = 0;
+    for (i = 0; i < $size(args); i++)
+        sum += args[i].max_size;
+
+    return casting(sum + 100);
+}
+
+TEST(go_inline) {
+    waitgroup_t wg = waitgroup_ex(3);
+    /* none, within `CORO_INLINE_ARGS` default, and over it */
+    rid_t none = go(sum_args, 0);
+    rid_t inlined = go(sum_args, 4, casting(1), casting(2), casting(3), casting(4));
+    rid_t heaped = go(sum_args, 6, casting(1), casting(2), casting(3), casting(4), casting(5), casting(6));
+    waitresult_t wgr = waitfor(wg);
+
+    ASSERT_UEQ(3, $size(wgr));
+    ASSERT_UEQ(100, result_for(none).max_size);
+    ASSERT_UEQ(110, result_for(inlined).max_size);
+    ASSERT_UEQ(121, result_for(heaped).max_size);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(go_inline);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
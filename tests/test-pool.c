@@ -0,0 +1,118 @@
+#include "raii.h"
+#include "test_assert.h"
+
+typedef struct {
+    raii_type type;
+    int value;
+    void_t data[4];
+} pooled_t;
+
+static raii_pool_t test_pool = RAII_POOL_INIT("pooled_t", pooled_t);
+static pooled_t *objects[RAII_POOL_BATCH * 3];
+
+int return_objects(void_t arg) {
+    int i;
+    for (i = 0; i < RAII_POOL_BATCH * 3; i++)
+        raii_pool_free(&test_pool, objects[i]);
+
+    raii_pool_flush();
+    return 0;
+}
+
+TEST(raii_pool_alloc) {
+    raii_pool_stats_t stats;
+    pooled_t *first = raii_pool_alloc(&test_pool), *again;
+
+    ASSERT_NOTNULL(first);
+    ASSERT_EQ(0, first->value);
+    first->type = RAII_STRUCT;
+    first->value = 42;
+
+    stats = raii_pool_stats(&test_pool);
+    ASSERT_STR("pooled_t", stats.name);
+    ASSERT_TRUE((stats.size >= sizeof(pooled_t)));
+    ASSERT_UEQ(RAII_POOL_BATCH, stats.capacity);
+    ASSERT_UEQ(1, stats.chunks);
+    ASSERT_UEQ(1, stats.in_use);
+    ASSERT_UEQ(RAII_POOL_BATCH - 1, stats.cached);
+
+    /* freed object keeps it's type field, next taker gets it zeroed */
+    raii_pool_free(&test_pool, first);
+    ASSERT_EQ(RAII_STRUCT, first->type);
+    again = raii_pool_alloc(&test_pool);
+    ASSERT_PTR(first, again);
+    ASSERT_EQ(0, again->value);
+    raii_pool_free(&test_pool, again);
+
+    stats = raii_pool_stats(&test_pool);
+    ASSERT_UEQ(0, stats.in_use);
+    ASSERT_UEQ(RAII_POOL_BATCH, stats.cached);
+
+    return 0;
+}
+
+TEST(raii_pool_free) {
+    raii_pool_stats_t stats;
+    thrd_t thread;
+    int i;
+
+    for (i = 0; i < RAII_POOL_BATCH * 3; i++)
+        objects[i] = raii_pool_alloc(&test_pool);
+
+    stats = raii_pool_stats(&test_pool);
+    ASSERT_UEQ(RAII_POOL_BATCH * 3, stats.capacity);
+    ASSERT_UEQ(RAII_POOL_BATCH * 3, stats.in_use);
+    ASSERT_UEQ(0, stats.cached);
+
+    /* returned by another thread, reaching pool in batches */
+    ASSERT_EQ(thrd_success, thrd_create(&thread, return_objects, nullptr));
+    ASSERT_EQ(thrd_success, thrd_join(thread, nullptr));
+    stats = raii_pool_stats(&test_pool);
+    ASSERT_UEQ(0, stats.in_use);
+    ASSERT_UEQ(RAII_POOL_BATCH * 3, stats.shared);
+
+    /* taken back an batch at a time, no new chunk */
+    for (i = 0; i < RAII_POOL_BATCH * 3; i++)
+        objects[i] = raii_pool_alloc(&test_pool);
+
+    stats = raii_pool_stats(&test_pool);
+    ASSERT_UEQ(RAII_POOL_BATCH * 3, stats.capacity);
+    ASSERT_UEQ(0, stats.shared);
+    for (i = 0; i < RAII_POOL_BATCH * 3; i++)
+        raii_pool_free(&test_pool, objects[i]);
+
+    return 0;
+}
+
+TEST(raii_pool_print) {
+    char line[1024] = {0}, *entry;
+    FILE *out = tmpfile();
+
+    ASSERT_NOTNULL(out);
+    raii_pool_print(out);
+    rewind(out);
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    fclose(out);
+
+    ASSERT_EQ(0, strncmp(line, "{\"pools\":[", 10));
+    ASSERT_NOTNULL((entry = strstr(line, "{\"name\":\"pooled_t\"")));
+    /* all returned by `raii_pool_free` test */
+    ASSERT_NOTNULL(strstr(entry, "\"in_use\":0,"));
+    ASSERT_STR("]}\n", line + strlen(line) - 3);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(raii_pool_alloc);
+    EXEC_TEST(raii_pool_free);
+    EXEC_TEST(raii_pool_print);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -0,0 +1,110 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+static volatile bool stop_spinning = false;
+static volatile int others_ran = 0;
+
+void_t spinner(params_t args) {
+    volatile size_t sum = 0;
+
+    while (!stop_spinning) {
+        sum++;
+        preempt_check();
+    }
+
+    return 0;
+}
+
+void_t stopper(params_t args) {
+    others_ran++;
+    stop_spinning = true;
+    return 0;
+}
+
+void_t allocator(params_t args) {
+    size_t preempted = preempt_stats().preempted;
+
+    /* no `preempt_check()`, switched at `calloc_local` safe point */
+    while (preempt_stats().preempted == preempted)
+        calloc_local(1, 16);
+
+    stop_spinning = true;
+    return 0;
+}
+
+void_t counter(params_t args) {
+    others_ran++;
+    return 0;
+}
+
+TEST(preempt_check) {
+    preempt_stats_t stats;
+
+    preempt_init(1000);
+    go(spinner, 0);
+    go(stopper, 0);
+    while (!stop_spinning)
+        preempt_check();
+
+    stats = preempt_stats();
+    ASSERT_TRUE((stats.ticks > 0));
+    ASSERT_TRUE((stats.preempted > 0));
+    ASSERT_EQ(1, others_ran);
+
+    return 0;
+}
+
+TEST(preempt_safe_point) {
+    stop_spinning = false;
+    go(allocator, 0);
+    while (!stop_spinning)
+        yield();
+
+    ASSERT_TRUE((preempt_stats().preempted > 0));
+
+    return 0;
+}
+
+TEST(preempt_disable) {
+    preempt_stats_t stats;
+    volatile size_t sum = 0;
+    bool yielded = false;
+    uint64_t start;
+    int before;
+
+    go(counter, 0);
+    preempt_disable();
+    before = others_ran;
+    start = get_timer();
+    while (get_timer() - start < 20000000) {
+        sum++;
+        yielded |= preempt_check();
+    }
+
+    ASSERT_FALSE(yielded);
+    ASSERT_EQ(before, others_ran);
+    preempt_enable();
+    ASSERT_EQ(before + 1, others_ran);
+
+    stats = preempt_stats();
+    ASSERT_TRUE((stats.deferred > 0));
+    ASSERT_TRUE((stats.overruns > 0));
+    preempt_stop();
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(preempt_check);
+    EXEC_TEST(preempt_safe_point);
+    EXEC_TEST(preempt_disable);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
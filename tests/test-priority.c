@@ -0,0 +1,73 @@
+#include "raii.h"
+#include "test_assert.h"
+
+static char order[16];
+static int ran = 0, high_ran = 0, low_seen = -1;
+
+void_t mark(params_t args) {
+    order[ran++] = (char)args[0].integer;
+    return 0;
+}
+
+void_t high(params_t args) {
+    int i;
+    for (i = 0; i < 50; i++) {
+        high_ran++;
+        yield();
+    }
+
+    return 0;
+}
+
+void_t low(params_t args) {
+    low_seen = high_ran;
+    return 0;
+}
+
+TEST(go_priority) {
+    waitgroup_t wg = waitgroup_ex(5);
+    go_priority(CORO_PRIORITY_LOW, mark, 1, casting('l'));
+    go(mark, 1, casting('n'));
+    go_priority(CORO_PRIORITY_HIGH, mark, 1, casting('h'));
+    go_deadline(100, mark, 1, casting('b'));
+    go_deadline(10, mark, 1, casting('a'));
+    waitfor(wg);
+
+    ASSERT_EQ(5, ran);
+    ASSERT_STR("abhnl", order);
+
+    return 0;
+}
+
+TEST(coro_priority_aging) {
+    waitgroup_t wg = waitgroup_ex(3);
+    go_priority(CORO_PRIORITY_HIGH, high, 0);
+    go_priority(CORO_PRIORITY_HIGH, high, 0);
+    go_priority(CORO_PRIORITY_LOW, low, 0);
+    waitfor(wg);
+
+    /* low class not starved, until both high finish */
+    ASSERT_TRUE((low_seen >= 0));
+    ASSERT_TRUE((low_seen <= CORO_PRIORITY_AGING + 1));
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(go_priority);
+    EXEC_TEST(coro_priority_aging);
+
+    return result;
+}
+
+static int test_main(u32 argc, void_t argv) {
+    TEST_FUNC(list());
+}
+
+int main(int argc, char **argv) {
+    /* one scheduler thread, so run order is exact */
+    coro_workers(1);
+    return coro_start(test_main, (u32)argc, argv, 0);
+}
@@ -0,0 +1,105 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+void_t hog(params_t args) {
+    uint64_t start;
+    int i;
+
+    coro_name("hog");
+    for (i = 0; i < 5; i++) {
+        start = get_timer();
+        while (get_timer() - start < 2000000);
+        yield();
+    }
+
+    return casting(i);
+}
+
+void_t light(params_t args) {
+    int i;
+
+    coro_name("light");
+    for (i = 0; i < 50; i++)
+        yield();
+
+    return casting(i);
+}
+
+TEST(coro_profile) {
+    char line[256];
+    bool hog_slow = false;
+    FILE *out = tmpfile();
+    waitgroup_t wg;
+    waitresult_t wgr;
+
+    ASSERT_NOTNULL(out);
+    coro_profile_start(1000);
+    wg = waitgroup();
+    go(hog, 0);
+    go(light, 0);
+    go(light, 0);
+    wgr = waitfor(wg);
+
+    coro_profile_stop();
+    coro_profile_folded(out);
+    rewind(out);
+    while (fgets(line, sizeof(line), out)) {
+        ASSERT_EQ(0, strncmp(line, "thread ", 7));
+        if (strstr(line, ";hog;[slow] "))
+            hog_slow = true;
+    }
+
+    ASSERT_TRUE(hog_slow);
+
+    rewind(out);
+    coro_profile_report(out);
+    rewind(out);
+    ASSERT_NOTNULL(fgets(line, sizeof(line), out));
+    ASSERT_EQ(0, strncmp(line, "thread", 6));
+    fclose(out);
+
+    return 0;
+}
+
+TEST(coro_profile_restart) {
+    char line[256];
+    bool has_hog = false, has_light = false;
+    FILE *out = tmpfile();
+    waitgroup_t wg;
+    waitresult_t wgr;
+
+    ASSERT_NOTNULL(out);
+    /* slices from earlier start are dropped, not reported again */
+    coro_profile_start(1000);
+    wg = waitgroup();
+    go(light, 0);
+    wgr = waitfor(wg);
+
+    coro_profile_stop();
+    coro_profile_report(out);
+    rewind(out);
+    while (fgets(line, sizeof(line), out)) {
+        has_hog |= strstr(line, " hog ") != nullptr;
+        has_light |= strstr(line, " light ") != nullptr;
+    }
+
+    ASSERT_FALSE(has_hog);
+    ASSERT_TRUE(has_light);
+    fclose(out);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_profile);
+    EXEC_TEST(coro_profile_restart);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
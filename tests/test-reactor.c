@@ -0,0 +1,166 @@
+#define USE_CORO
+#include "raii.h"
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "test_assert.h"
+
+#define PIPE_BYTES (1024 * 1024)
+
+static int pipe_fds[2];
+
+void_t pipe_writer(params_t args) {
+    string buf = calloc_local(1, PIPE_BYTES);
+    ssize_t written;
+
+    memset(buf, 'x', PIPE_BYTES);
+    /* larger than pipe buffer, parks until reader drains */
+    written = coro_write(pipe_fds[1], buf, PIPE_BYTES);
+    close(pipe_fds[1]);
+    return casting(written);
+}
+
+void_t pipe_reader(params_t args) {
+    char buf[4096];
+    size_t total = 0;
+    ssize_t n;
+
+    while ((n = coro_read(pipe_fds[0], buf, sizeof(buf))) > 0)
+        total += n;
+
+    close(pipe_fds[0]);
+    return casting(total);
+}
+
+static routine_t *waiting = nullptr;
+
+void_t pipe_waiter(params_t args) {
+    char buf[16];
+    ssize_t n;
+
+    waiting = coro_active();
+    /* nothing ever written, only `coro_enqueue` can end it */
+    n = coro_read(pipe_fds[0], buf, sizeof(buf));
+    waiting = nullptr;
+    return casting(n < 0 && errno == ECANCELED);
+}
+
+void_t pipe_canceller(params_t args) {
+    while (is_empty(waiting))
+        sleepfor(1);
+
+    sleepfor(10);
+    coro_enqueue(waiting);
+    return casting(1);
+}
+
+static int listener;
+static u16 port;
+
+void_t echo_server(params_t args) {
+    char buf[64];
+    ssize_t n;
+    int client = coro_accept(listener, nullptr, nullptr);
+
+    if (client < 0)
+        return casting(-1);
+
+    while ((n = coro_read(client, buf, sizeof(buf))) > 0)
+        coro_write(client, buf, n);
+
+    close(client);
+    return casting(n == 0);
+}
+
+void_t echo_client(params_t args) {
+    struct sockaddr_in addr;
+    char buf[64] = {0};
+    size_t got = 0;
+    ssize_t n;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    coro_nonblock(fd);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (coro_connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        return casting(-1);
+
+    coro_write(fd, "hello reactor", 13);
+    while (got < 13 && (n = coro_read(fd, buf + got, sizeof(buf) - got)) > 0)
+        got += n;
+
+    close(fd);
+    return casting(got == 13 && memcmp(buf, "hello reactor", 13) == 0);
+}
+
+TEST(coro_reactor) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    waitgroup_t wg;
+    waitresult_t wgr;
+    rid_t reader, writer, server, client;
+
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(0, coro_nonblock(pipe_fds[0]));
+    ASSERT_EQ(0, coro_nonblock(pipe_fds[1]));
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_TRUE((listener >= 0));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, bind(listener, (struct sockaddr *)&addr, sizeof(addr)));
+    ASSERT_EQ(0, listen(listener, 8));
+    ASSERT_EQ(0, getsockname(listener, (struct sockaddr *)&addr, &len));
+    ASSERT_EQ(0, coro_nonblock(listener));
+    port = ntohs(addr.sin_port);
+
+    wg = waitgroup();
+    reader = go(pipe_reader, 0);
+    writer = go(pipe_writer, 0);
+    server = go(echo_server, 0);
+    client = go(echo_client, 0);
+    wgr = waitfor(wg);
+
+    ASSERT_UEQ(PIPE_BYTES, result_for(reader).max_size);
+    ASSERT_UEQ(PIPE_BYTES, result_for(writer).max_size);
+    ASSERT_EQ(1, result_for(server).integer);
+    ASSERT_EQ(1, result_for(client).integer);
+    close(listener);
+
+    return 0;
+}
+
+TEST(coro_reactor_cancel) {
+    waitgroup_t wg;
+    waitresult_t wgr;
+    rid_t waiter;
+
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(0, coro_nonblock(pipe_fds[0]));
+
+    wg = waitgroup();
+    waiter = go(pipe_waiter, 0);
+    go(pipe_canceller, 0);
+    wgr = waitfor(wg);
+
+    ASSERT_EQ(1, result_for(waiter).integer);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_reactor);
+    EXEC_TEST(coro_reactor_cancel);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
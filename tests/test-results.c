@@ -0,0 +1,71 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+void_t worker(params_t args) {
+    return "done";
+}
+
+static rid_t others[RAII_RESULT_REUSE];
+
+TEST(raii_result_free) {
+    result_t result = raii_result_create();
+    rid_t rid = result->id, reused;
+    int i;
+    ASSERT_TRUE(is_type(raii_result_get(rid), RAII_VALUE));
+
+    raii_result_free(rid);
+    ASSERT_FALSE(is_type(raii_result_get(rid), RAII_VALUE));
+    ASSERT_FALSE(result_is_ready(rid));
+
+    /* not reused, until `RAII_RESULT_REUSE` others are freed after it */
+    for (i = 0; i < RAII_RESULT_REUSE; i++) {
+        others[i] = raii_result_create()->id;
+        ASSERT_TRUE((RAII_RESULT_INDEX(others[i]) != RAII_RESULT_INDEX(rid)));
+    }
+
+    for (i = 0; i < RAII_RESULT_REUSE; i++)
+        raii_result_free(others[i]);
+
+    /* then oldest first */
+    reused = raii_result_create()->id;
+    ASSERT_UEQ(RAII_RESULT_INDEX(rid), RAII_RESULT_INDEX(reused));
+    ASSERT_TRUE((rid != reused));
+    ASSERT_FALSE(is_type(raii_result_get(rid), RAII_VALUE));
+    ASSERT_TRUE(is_type(raii_result_get(reused), RAII_VALUE));
+    raii_result_free(reused);
+
+    return 0;
+}
+
+TEST(result_for) {
+    rid_t rid[4];
+    int i;
+
+    waitgroup_t wg = waitgroup();
+    for (i = 0; i < 4; i++)
+        rid[i] = go(worker, 0);
+
+    waitresult_t wgr = waitfor(wg);
+    ASSERT_TRUE(($size(wgr) == 4));
+    for (i = 0; i < 4; i++) {
+        ASSERT_TRUE(result_is_ready(rid[i]));
+        ASSERT_STR("done", result_for(rid[i]).char_ptr);
+        ASSERT_FALSE(result_is_ready(rid[i]));
+    }
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(raii_result_free);
+    EXEC_TEST(result_for);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -0,0 +1,51 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+#define SLEEPERS 512
+
+static u32 slept[SLEEPERS];
+static u32 wanted[SLEEPERS];
+
+void_t sleeper(params_t args) {
+    int i = args[0].integer;
+    slept[i] = sleepfor(wanted[i]);
+    return 0;
+}
+
+TEST(sleepfor) {
+    ASSERT_TRUE(sleepfor(5) >= 5);
+    return 0;
+}
+
+TEST(sleepfor_many) {
+    int i, woken = 0;
+
+    for (i = 0; i < SLEEPERS; i++) {
+        wanted[i] = (u32)((i * 7919) % 50) + 1;
+        slept[i] = 0;
+        go(sleeper, 1, casting(i));
+    }
+
+    sleepfor(250);
+    for (i = 0; i < SLEEPERS; i++) {
+        if (slept[i] >= wanted[i])
+            woken++;
+    }
+
+    ASSERT_EQ(SLEEPERS, woken);
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(sleepfor);
+    EXEC_TEST(sleepfor_many);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -0,0 +1,47 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+static volatile int caught = 0, depth = 0;
+
+int recurse(int n) {
+    volatile char pad[512];
+    pad[0] = (char)n;
+    depth++;
+    return recurse(n + 1) + pad[0];
+}
+
+void_t overflow(params_t args) {
+    try {
+        recurse(0);
+    } catch (stack_overflow) {
+        caught = 1;
+    }
+
+    return casting(depth);
+}
+
+TEST(stack_overflow) {
+    waitgroup_t wg = waitgroup();
+    rid_t cid = go(overflow, 0);
+    waitresult_t wgr = waitfor(wg);
+
+    /* guard page below the stack, hit as `stack_overflow`, not an crash */
+    ASSERT_EQ(1, caught);
+    ASSERT_TRUE((depth > 1));
+    ASSERT_TRUE((result_for(cid).integer == depth));
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(stack_overflow);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
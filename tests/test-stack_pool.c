@@ -0,0 +1,59 @@
+#define USE_CORO
+#include "raii.h"
+#include "test_assert.h"
+
+void_t worker(params_t args) {
+    yield();
+    return 0;
+}
+
+TEST(coro_stack_pool_stats) {
+    stack_pool_stats_t stats;
+    int i, n;
+
+    for (n = 0; n < 2; n++) {
+        for (i = 0; i < 8; i++)
+            go(worker, 0);
+
+        sleepfor(10);
+    }
+
+    stats = coro_stack_pool_stats();
+    ASSERT_TRUE(stats.misses > 0);
+    ASSERT_TRUE(stats.hits > 0);
+
+    return 0;
+}
+
+TEST(coro_stack_pool_trim) {
+    stack_pool_stats_t stats, before;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        go(worker, 0);
+
+    sleepfor(10);
+    before = coro_stack_pool_stats();
+    ASSERT_TRUE((before.cached > 0));
+
+    coro_stack_pool_trim(0);
+    stats = coro_stack_pool_stats();
+    ASSERT_UEQ(0, stats.cached);
+    /* every stack cached before, freed and counted */
+    ASSERT_TRUE((stats.trimmed >= before.trimmed + before.cached));
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_stack_pool_stats);
+    EXEC_TEST(coro_stack_pool_trim);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}
@@ -0,0 +1,66 @@
+#include "raii.h"
+#include "test_assert.h"
+
+static atomic_size_t finished;
+
+/* Coroutines starting on worker `1` run long, others finish quickly,
+leaving workers `2` and `3` idle, with worker `1` deque still full. */
+void_t worker(params_t args) {
+    int i, rounds = coro_thrd_id() == 1 ? args[0].integer : 2;
+    volatile long sum = 0;
+    long k;
+
+    for (i = 0; i < rounds; i++) {
+        for (k = 0; k < 10000; k++)
+            sum += k;
+
+        yield();
+    }
+
+    atomic_fetch_add(&finished, 1);
+    return 0;
+}
+
+TEST(coro_steal_stats) {
+    steal_stats_t stats;
+    size_t stolen = 0, lost = 0;
+    u32 i;
+
+    for (i = 0; i < 64; i++)
+        go(worker, 1, casting(40));
+
+    yield();
+    while (atomic_load(&finished) < 64)
+        sleepfor(10);
+
+    for (i = 0; i < 64; i++) {
+        stats = coro_steal_stats(i);
+        ASSERT_TRUE((stats.failures <= stats.attempts));
+        stolen += stats.stolen;
+        lost += stats.lost;
+    }
+
+    ASSERT_TRUE((stolen > 0));
+    ASSERT_UEQ(stolen, lost);
+    stats = coro_steal_stats((u32)-1);
+    ASSERT_UEQ(0, stats.attempts);
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_steal_stats);
+
+    return result;
+}
+
+static int test_main(u32 argc, void_t argv) {
+    TEST_FUNC(list());
+}
+
+int main(int argc, char **argv) {
+    coro_workers(4);
+    return coro_start(test_main, (u32)argc, argv, 0);
+}
@@ -20,6 +20,31 @@ void_t check_primes(void_t result, size_t id, vectors_t object) {
     return result;
 }
 
+void_t sum_range(i64 start, i64 end) {
+    size_t sum = 0;
+    i64 i;
+    for (i = start; i < end; i++)
+        sum += (size_t)i;
+
+    return $(casting(sum));
+}
+
+void_t sum_chunks(void_t result, size_t id, vectors_t object) {
+    *(size_t *)result += object[0].max_size;
+    return result;
+}
+
+TEST(thrd_for) {
+    size_t total = 0;
+    future_t fut = thrd_for(sum_range, 1, 10000);
+    ASSERT_TRUE(is_type(fut, RAII_SPAWN));
+
+    thrd_then(sum_chunks, thrd_sync(fut), &total);
+    ASSERT_UEQ(50005000, total);
+
+    return 0;
+}
+
 TEST(thrd_spawn) {
     int data = 1;
     int prime = 194232491;
@@ -46,6 +71,7 @@ TEST(list) {
     int result = 0;
 
     EXEC_TEST(thrd_spawn);
+    EXEC_TEST(thrd_for);
 
     return result;
 }
@@ -0,0 +1,108 @@
+#define USE_CORO
+#include "channel.h"
+#include "test_assert.h"
+
+void_t ping(params_t args) {
+    channel_t c = args[0].object;
+    int i;
+
+    for (i = 1; i <= 3; i++) {
+        chan_send(c, casting(i));
+        yield();
+    }
+
+    sleepfor(5);
+    return casting(i);
+}
+
+void_t pong(params_t args) {
+    channel_t c = args[0].object;
+    int i, sum = 0;
+
+    for (i = 0; i < 3; i++)
+        sum += chan_recv(c).integer;
+
+    return casting(sum);
+}
+
+void_t spin(params_t args) {
+    int i;
+
+    for (i = 0; i < 200; i++)
+        yield();
+
+    return casting(i);
+}
+
+TEST(coro_trace_restart) {
+    waitgroup_t wg;
+    waitresult_t wgr;
+    u32 i;
+
+    /* Restarting with other sizes, while workers are recording. */
+    coro_trace_start(16);
+    wg = waitgroup();
+    for (i = 0; i < 8; i++)
+        go(spin, 0);
+
+    coro_trace_start(4096);
+    yield();
+    coro_trace_start(64);
+    yield();
+    coro_trace_start(8192);
+    wgr = waitfor(wg);
+    coro_trace_stop();
+    ASSERT_UEQ(8, $size(wgr));
+
+    return 0;
+}
+
+TEST(coro_trace) {
+    char *json;
+    long size;
+    FILE *out = tmpfile();
+    channel_t c = channel();
+    waitgroup_t wg;
+    waitresult_t wgr;
+
+    ASSERT_NOTNULL(out);
+    coro_trace_start(1024);
+    wg = waitgroup();
+    go(ping, 1, c);
+    go(pong, 1, c);
+    wgr = waitfor(wg);
+    coro_trace_stop();
+    channel_free(c);
+
+    coro_trace_dump(out);
+    size = ftell(out);
+    ASSERT_TRUE((size > 0));
+    json = calloc_local(1, size + 1);
+    rewind(out);
+    ASSERT_UEQ(size, fread(json, 1, size, out));
+    fclose(out);
+
+    ASSERT_EQ(0, strncmp(json, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 39));
+    ASSERT_STR("\n]}\n", json + size - 4);
+    ASSERT_NOTNULL(strstr(json, "\"ph\":\"M\""));
+    ASSERT_NOTNULL(strstr(json, "\"ph\":\"X\""));
+    ASSERT_NOTNULL(strstr(json, "\"name\":\"spawn\""));
+    ASSERT_NOTNULL(strstr(json, "\"name\":\"yield\""));
+    ASSERT_NOTNULL(strstr(json, "\"name\":\"sleep\",\"cat\":\"sched\""));
+    ASSERT_NOTNULL(strstr(json, "\"name\":\"chan_block\""));
+
+    return 0;
+}
+
+TEST(list) {
+    int result = 0;
+
+    EXEC_TEST(coro_trace);
+    EXEC_TEST(coro_trace_restart);
+
+    return result;
+}
+
+int main(int argc, char **argv) {
+    TEST_FUNC(list());
+}